@@ -2,8 +2,16 @@
 
 #include "Light.h"
 
+#include <algorithm>
+
+#include "Clock.h"
+
 LOG_TAG(Light);
 
+// Interval between the steps of a transition. Smooth enough for a fade, without waking
+// up at every millisecond.
+static constexpr uint32_t TRANSITION_FRAME_MS = 10;
+
 RGB hsi2rgb(float H, float S, float I) {
     float r, g, b;
     H = fmodf(H, 360);                // cycle H around to 0-360 degrees
@@ -55,11 +63,11 @@ void LightBase::reconfigure(float minimumLevel, float maximumLevel, uint32_t tim
 void LightBase::begin() { resetTransition(); }
 
 void LightBase::update() {
-    if (!_transitionStart) {
+    if (!_transitionRunning) {
         return;
     }
 
-    auto currentMillis = esp_timer_get_time() / 1000;
+    auto currentMillis = Clock::now_ms();
     auto diff = currentMillis - _transitionStart;
 
     if (diff >= _transitionTime) {
@@ -78,6 +86,20 @@ void LightBase::update() {
     }
 }
 
+uint32_t LightBase::getUpdateDelay() {
+    if (!_transitionRunning) {
+        return UINT32_MAX;
+    }
+
+    // The last step lands on the end of the transition, which resets it.
+    const auto elapsed = uint32_t(Clock::now_ms()) - _transitionStart;
+    if (elapsed >= _transitionTime) {
+        return 0;
+    }
+
+    return std::min(TRANSITION_FRAME_MS, _transitionTime - elapsed);
+}
+
 void LightBase::setLevel(float level, uint32_t time) {
     if (level < 0.0f) {
         level = 0.0f;
@@ -92,8 +114,9 @@ void LightBase::setLevel(float level, uint32_t time) {
         resetTransition();
     } else {
         _startLevel = _actualLevel;
-        _transitionStart = esp_timer_get_time() / 1000;
+        _transitionStart = Clock::now_ms();
         _transitionTime = time;
+        _transitionRunning = true;
 
         // Let update handle setting the value.
     }
@@ -107,9 +130,10 @@ void LightBase::resetTransition() {
     _startLevel = scaledLevel;
     _transitionStart = 0;
     _transitionTime = 0;
+    _transitionRunning = false;
 
     _actualLevel = scaledLevel;
-    _lastUpdate = esp_timer_get_time() / 1000;
+    _lastUpdate = Clock::now_ms();
 
     updateDutyCycle();
 }
@@ -33,8 +33,10 @@ public:
     bool isOn() const { return _level > 0; }
     float getLevel() const { return _level; }
     uint16_t getTemperature() const { return _low->getTemperature(); }
-    void onLevelChanged(std::function<void(float)> func) { _levelChanged.add(func); }
-    void onTemperatureChanged(std::function<void(uint16_t)> func) { _temperatureChanged.add(func); }
+    CallbackToken onLevelChanged(Callback<float>::Function func) { return _levelChanged.add(std::move(func)); }
+    CallbackToken onTemperatureChanged(Callback<uint16_t>::Function func) {
+        return _temperatureChanged.add(std::move(func));
+    }
     void onHighWarmDutyCycleChanged(std::function<void(float)> func) { _high->onWarmDutyCycleChanged(func); }
     void onHighColdDutyCycleChanged(std::function<void(float)> func) { _high->onColdDutyCycleChanged(func); }
     void onLowWarmDutyCycleChanged(std::function<void(float)> func) { _low->onWarmDutyCycleChanged(func); }
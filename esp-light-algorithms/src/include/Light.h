@@ -43,6 +43,7 @@ class LightBase {
     uint32_t _transitionStart{};
     uint32_t _lastUpdate{};
     uint32_t _transitionTime{};
+    bool _transitionRunning{};
 
 public:
     LightBase() {}
@@ -51,9 +52,12 @@ public:
     void begin();
     bool isOn() { return _level > 0; }
     float getLevel() { return _level; }
-    void onLevelChanged(std::function<void(float)> func) { _levelChanged.add(func); }
-    void onDutyCycleChanged(std::function<void(float)> func) { _dutyCycleChanged.add(func); }
+    CallbackToken onLevelChanged(Callback<float>::Function func) { return _levelChanged.add(std::move(func)); }
+    CallbackToken onDutyCycleChanged(Callback<float>::Function func) { return _dutyCycleChanged.add(std::move(func)); }
     void update();
+    // Milliseconds until update() needs to be called again, or UINT32_MAX if there's
+    // no transition running.
+    uint32_t getUpdateDelay();
     void setLevel(float level, uint32_t time = 0);
     void resetTransition();
 
@@ -38,8 +38,10 @@ public:
     bool isOn() const { return _level > 0; }
     float getLevel() const { return _level; }
     uint16_t getTemperature() const { return _temperature; }
-    void onLevelChanged(std::function<void(float)> func) { _levelChanged.add(func); }
-    void onTemperatureChanged(std::function<void(uint16_t)> func) { _temperatureChanged.add(func); }
+    CallbackToken onLevelChanged(Callback<float>::Function func) { return _levelChanged.add(std::move(func)); }
+    CallbackToken onTemperatureChanged(Callback<uint16_t>::Function func) {
+        return _temperatureChanged.add(std::move(func));
+    }
     void onColdDutyCycleChanged(std::function<void(float)> func) { _cold.onDutyCycleChanged(func); }
     void onWarmDutyCycleChanged(std::function<void(float)> func) { _warm.onDutyCycleChanged(func); }
 
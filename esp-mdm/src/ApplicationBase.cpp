@@ -4,6 +4,7 @@
 
 #include "CoreDumpUploader.h"
 #include "OTAManager.h"
+#include "Tracer.h"
 #include "cJSON.h"
 #include "driver/i2c.h"
 #include "http_support.h"
@@ -22,9 +23,14 @@ LOG_TAG(ApplicationBase);
 bool _shutdown_initiated{};
 
 ApplicationBase::ApplicationBase()
-    : _network_connection(&_queue), _mqtt_connection(&_queue), _log_manager(_mqtt_connection) {}
+    : _network_connection(&_queue),
+      _mqtt_connection(&_queue),
+      _log_manager(_mqtt_connection),
+      _telemetry(&_queue, _mqtt_connection) {}
 
 void ApplicationBase::begin() {
+    TRACE_SCOPE("begin");
+
     const auto reset_reason = esp_reset_reason();
     _silent_startup = reset_reason == ESP_RST_BROWNOUT || reset_reason == ESP_RST_WDT;
 
@@ -32,9 +38,13 @@ void ApplicationBase::begin() {
 
     ESP_LOGI(TAG, "Loading provisioning data");
 
+    TRACE_BEGIN("load_provisioning");
     ESP_ERROR_CHECK(_mdm_configuration.load());
+    TRACE_END("load_provisioning");
 
+    TRACE_BEGIN("do_begin");
     do_begin();
+    TRACE_END("do_begin");
 
     begin_network();
 
@@ -44,6 +54,8 @@ void ApplicationBase::begin() {
 }
 
 esp_err_t ApplicationBase::setup_flash() {
+    TRACE_SCOPE("setup_flash");
+
     ESP_LOGI(TAG, "Setting up flash");
 
     auto ret = nvs_flash_init();
@@ -55,6 +67,8 @@ esp_err_t ApplicationBase::setup_flash() {
 }
 
 void ApplicationBase::begin_network() {
+    TRACE_SCOPE("begin_network");
+
     ESP_LOGI(TAG, "Connecting to WiFi");
 
     _network_connection.on_state_changed([this](auto state) {
@@ -73,11 +87,14 @@ void ApplicationBase::begin_network() {
 }
 
 void ApplicationBase::begin_network_available() {
+    TRACE_SCOPE("network_available");
+
     ESP_LOGI(TAG, "Getting device configuration");
 
     ESP_ERROR_CHECK(load_device_configuration());
 
     _log_manager.set_device_entity_id(_device_entity_id);
+    _telemetry.set_device_entity_id(_device_entity_id);
 
     ESP_LOGI(TAG, "Checking for core dump to upload");
 
@@ -89,11 +106,15 @@ void ApplicationBase::begin_network_available() {
 
     ESP_LOGI(TAG, "Configuration loaded; signalling network available");
 
+    TRACE_BEGIN("do_network_available");
     do_network_available();
+    TRACE_END("do_network_available");
 
     ESP_LOGI(TAG, "Connecting to MQTT");
 
-    _mqtt_connection.on_connected_changed([this](auto state) {
+    // This runs again when WiFi reconnects.
+    _mqtt_connection.remove_connected_changed(_connected_changed_token);
+    _connected_changed_token = _mqtt_connection.on_connected_changed([this](auto state) {
         if (state.connected) {
             _queue.enqueue([this]() { begin_after_initialization(); });
         } else {
@@ -110,10 +131,14 @@ void ApplicationBase::begin_network_available() {
         .device_entity_id = _device_entity_id,
     });
 
+    TRACE_INSTANT("mqtt_connecting");
+
     _mqtt_connection.begin();
 }
 
 esp_err_t ApplicationBase::ensure_access_token() {
+    TRACE_SCOPE("ensure_access_token");
+
     // Check if we have a valid token (with 30 second buffer).
     auto now = esp_get_millis();
     if (!_access_token.empty() && now + 30000 < _token_expires_at) {
@@ -175,6 +200,8 @@ esp_err_t ApplicationBase::ensure_access_token() {
 }
 
 esp_err_t ApplicationBase::install_firmware_update() {
+    TRACE_SCOPE("install_firmware_update");
+
     if (!_enable_ota) {
         ESP_LOGI(TAG, "OTA disabled.");
         return ESP_OK;
@@ -197,6 +224,8 @@ esp_err_t ApplicationBase::install_firmware_update() {
 }
 
 esp_err_t ApplicationBase::load_device_configuration() {
+    TRACE_SCOPE("load_device_configuration");
+
     const auto url = _mdm_configuration.get_base_url() + DEVICE_CONFIGURATION_URL;
     esp_http_client_config_t config = {
         .url = url.c_str(),
@@ -267,6 +296,8 @@ esp_err_t ApplicationBase::parse_device_configuration(cJSON* data) {
 }
 
 void ApplicationBase::begin_after_initialization() {
+    TRACE_INSTANT("mqtt_connected");
+
     setup_mqtt_subscriptions();
 
     // Log the reset reason.
@@ -278,7 +309,25 @@ void ApplicationBase::begin_after_initialization() {
 
     register_shutdown_notification();
 
+    // Keeps running across reconnects.
+    _telemetry.begin();
+
+    TRACE_BEGIN("do_ready");
     do_ready();
+    TRACE_END("do_ready");
+
+#if CONFIG_ESP_SUPPORT_TRACE
+    // The trace now covers everything from begin() up to here.
+    if (publish_trace() != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to publish trace");
+    }
+#endif
+}
+
+esp_err_t ApplicationBase::publish_trace() {
+    return Tracer::dump([this](std::string_view chunk) {
+        return _mqtt_connection.publish(CONFIG_MDM_TRACE_TOPIC, std::string(chunk), 1, false) ? ESP_OK : ESP_FAIL;
+    });
 }
 
 void ApplicationBase::register_shutdown_notification() {
@@ -378,6 +427,12 @@ void ApplicationBase::process() {
     do_process();
 }
 
+void ApplicationBase::wait_and_process(uint32_t max_wait_ms) {
+    _queue.wait_and_process(max_wait_ms);
+
+    do_process();
+}
+
 const std::string& ApplicationBase::get_authorization() {
     ESP_ERROR_CHECK(ensure_access_token());
 
@@ -385,6 +440,8 @@ const std::string& ApplicationBase::get_authorization() {
 }
 
 esp_err_t ApplicationBase::upload_core_dump() {
+    TRACE_SCOPE("upload_core_dump");
+
     const auto url = _mdm_configuration.get_base_url() + DEVICE_COREDUMP_URL;
     CoreDumpUploader core_dump_uploader(this, url.c_str());
 
@@ -2,6 +2,8 @@
 
 #include "LogManager.h"
 
+#include "MemoryPool.h"
+#include "Metrics.h"
 #include "cJSON.h"
 
 constexpr auto BUFFER_SIZE = 1024;
@@ -15,6 +17,35 @@ LOG_TAG(LogManager);
 LogManager* LogManager::_instance = nullptr;
 // Intentional one-time allocation; freeing on shutdown provides no benefit.
 char* LogManager::_buffer = new char[BUFFER_SIZE];
+// Buffered messages that didn't fit in the pool, and the list of buffered messages.
+HeapAccount LogManager::_heap_account("log_manager");
+// Most log lines are short and only live until they're published. Keeping them in a
+// pool stops them from fragmenting the heap.
+static MemoryPool message_pool("log_messages", CONFIG_MDM_LOG_POOL_BLOCK_SIZE, CONFIG_MDM_LOG_POOL_SIZE);
+
+static MetricCounter published_metric("log.published");
+static MetricCounter dropped_metric("log.dropped");
+static MetricCounter publish_retries_metric("log.publish_retries");
+
+char* LogManager::copy_message(const char* message, size_t length) {
+    auto buffer = length < message_pool.get_block_size() ? (char*)message_pool.allocate() : nullptr;
+    if (!buffer) {
+        buffer = (char*)_heap_account.allocate(length + 1);
+        ESP_ASSERT_CHECK(buffer);
+    }
+
+    memcpy(buffer, message, length + 1);
+
+    return buffer;
+}
+
+void LogManager::free_message(char* buffer) {
+    if (message_pool.owns(buffer)) {
+        message_pool.deallocate(buffer);
+    } else {
+        _heap_account.deallocate(buffer);
+    }
+}
 
 int LogManager::log_handler(const char* message, va_list va) {
     if (!_instance) {
@@ -28,25 +59,23 @@ int LogManager::log_handler(const char* message, va_list va) {
 
     va_end(vaCopy);
 
-    auto result = _instance->_mutex.with<int>([message, va]() {
+    auto result = _instance->_mutex.with([message, va]() {
         while (_instance->_messages.size() > MAX_MESSAGES) {
-            free(_instance->_messages[0].buffer);
+            dropped_metric.increment();
+            free_message(_instance->_messages[0].buffer);
             _instance->_messages.erase(_instance->_messages.begin());
         }
 
         auto result = vsnprintf(_buffer, BUFFER_SIZE, message, va);
 
         if (result >= 0 && result < BUFFER_SIZE) {
-            auto buffer_copy = strdup(_buffer);
-            ESP_ASSERT_CHECK(buffer_copy);
-
-            _instance->_messages.push_back(Message(buffer_copy));
+            _instance->_messages.push_back(Message(copy_message(_buffer, result)));
         }
 
         return result;
     });
 
-    _instance->_signal.signal();
+    _instance->_events.signal(EVENT_MESSAGE);
 
     return result;
 }
@@ -62,7 +91,7 @@ esp_err_t LogManager::begin() {
 
     _mqtt_connection.on_connected_changed([this](auto state) {
         if (state.connected) {
-            _signal.signal();
+            _events.signal(EVENT_CONNECTED);
         }
     });
 
@@ -74,7 +103,7 @@ esp_err_t LogManager::begin() {
             ESP_LOGI(TAG, "Flushing log messages before restart");
 
             _instance->_shutting_down = true;
-            _instance->_signal.signal();
+            _instance->_events.signal(EVENT_SHUTDOWN);
 
             // Wait for messages to drain, polling every 100ms for up to 5 seconds.
             auto elapsed = 0;
@@ -93,22 +122,23 @@ esp_err_t LogManager::begin() {
 }
 
 void LogManager::set_device_entity_id(const std::string& device_entity_id) {
-    _mutex.with<void>([this, &device_entity_id]() { _device_entity_id = device_entity_id; });
+    _mutex.with([this, &device_entity_id]() { _device_entity_id = device_entity_id; });
 
-    _signal.signal();
+    _events.signal(EVENT_ENTITY_ID);
 }
 
 bool LogManager::can_send() {
-    return _mqtt_connection.is_connected() && _mutex.with<bool>([this]() { return !_device_entity_id.empty(); });
+    return _mqtt_connection.is_connected() && _mutex.with([this]() { return !_device_entity_id.empty(); });
 }
 
 size_t LogManager::get_message_count() {
-    return _mutex.with<size_t>([this]() { return _messages.size(); });
+    return _mutex.with([this]() { return _messages.size(); });
 }
 
 void LogManager::task_loop() {
     while (true) {
-        _signal.wait();
+        // Every reason means there may be something to publish now.
+        _events.wait_any();
 
         publish_messages();
     }
@@ -122,7 +152,7 @@ void LogManager::publish_messages() {
         std::vector<char*> buffers;
         std::string entity_id;
 
-        _mutex.with<void>([this, &buffers, &entity_id]() {
+        _mutex.with([this, &buffers, &entity_id]() {
             entity_id = _device_entity_id;
 
             while (!_messages.empty() && buffers.size() < MAX_BATCH_SIZE) {
@@ -154,9 +184,12 @@ void LogManager::publish_messages() {
         while (true) {
             auto success = _mqtt_connection.publish(CONFIG_MDM_LOG_TOPIC, payload, 1, false);
             if (success) {
+                published_metric.increment(uint32_t(buffers.size()));
                 break;
             }
 
+            publish_retries_metric.increment();
+
             // We retry indefinitely. There is no point in doing anything else. At
             // some point either we will be able to get these messages out, or, we'll
             // restart.
@@ -164,7 +197,7 @@ void LogManager::publish_messages() {
         }
 
         for (auto buffer : buffers) {
-            free(buffer);
+            free_message(buffer);
         }
 
         // Yield to allow MQTT client to process ACKs.
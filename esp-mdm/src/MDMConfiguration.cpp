@@ -6,19 +6,21 @@
 
 #include <set>
 
+#include "NVSProperty.h"
 #include "defer.h"
 
 #define NVS_NAMESPACE "prov"
 
 LOG_TAG(MDMConfiguration);
 
-static esp_err_t nvs_get_string(nvs_handle_t handle, const char* key, std::string& value) {
-    size_t length;
-    ESP_ERROR_RETURN(nvs_get_str(handle, key, nullptr, &length));
-
-    value.resize(length - 1);
-    return nvs_get_str(handle, key, value.data(), &length);
-}
+static NVSPropertyString nvs_device_key("device_key");
+static NVSPropertyString nvs_client_id("client_id");
+static NVSPropertyString nvs_client_secret("client_secret");
+static NVSPropertyString nvs_token_url("token_url");
+static NVSPropertyString nvs_base_url("base_url");
+static NVSPropertyString nvs_mqtt_url("mqtt_url");
+static NVSPropertyString nvs_wifi_ssid("wifi_ssid");
+static NVSPropertyString nvs_wifi_password("wifi_password");
 
 esp_err_t MDMConfiguration::load() {
     nvs_handle_t handle;
@@ -27,14 +29,14 @@ esp_err_t MDMConfiguration::load() {
 
     DEFER(nvs_close(handle));
 
-    ESP_ERROR_RETURN(nvs_get_string(handle, "device_key", _device_key));
-    ESP_ERROR_RETURN(nvs_get_string(handle, "client_id", _client_id));
-    ESP_ERROR_RETURN(nvs_get_string(handle, "client_secret", _client_secret));
-    ESP_ERROR_RETURN(nvs_get_string(handle, "token_url", _token_url));
-    ESP_ERROR_RETURN(nvs_get_string(handle, "base_url", _base_url));
-    ESP_ERROR_RETURN(nvs_get_string(handle, "mqtt_url", _mqtt_url));
-    ESP_ERROR_RETURN(nvs_get_string(handle, "wifi_ssid", _wifi_ssid));
-    ESP_ERROR_RETURN(nvs_get_string(handle, "wifi_password", _wifi_password));
+    ESP_ERROR_RETURN(nvs_device_key.read(handle, _device_key));
+    ESP_ERROR_RETURN(nvs_client_id.read(handle, _client_id));
+    ESP_ERROR_RETURN(nvs_client_secret.read(handle, _client_secret));
+    ESP_ERROR_RETURN(nvs_token_url.read(handle, _token_url));
+    ESP_ERROR_RETURN(nvs_base_url.read(handle, _base_url));
+    ESP_ERROR_RETURN(nvs_mqtt_url.read(handle, _mqtt_url));
+    ESP_ERROR_RETURN(nvs_wifi_ssid.read(handle, _wifi_ssid));
+    ESP_ERROR_RETURN(nvs_wifi_password.read(handle, _wifi_password));
 
     ESP_LOGI(TAG, "Configuration loaded:");
     ESP_LOGI(TAG, "  device_key: %s", _device_key.c_str());
@@ -0,0 +1,199 @@
+#include "support.h"
+
+#include "ResourceTelemetry.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "HeapAccount.h"
+#include "MemoryPool.h"
+#include "Metrics.h"
+#include "esp_heap_caps.h"
+
+LOG_TAG(ResourceTelemetry);
+
+#if !CONFIG_FREERTOS_USE_TRACE_FACILITY
+// Without the trace facility the tasks can't be enumerated, so only the tasks created
+// by the support components are sampled.
+static const char* const KNOWN_TASKS[] = {
+    "main", "log_manager", "acs725", "ldr", "sen0626", "ZigBee_main",
+};
+#endif
+
+void ResourceTelemetry::begin(uint32_t interval_s) {
+    if (_timer.is_valid() || !interval_s) {
+        return;
+    }
+
+    _timer = _queue->enqueue_periodic([this] { publish(); }, interval_s * 1000);
+    if (!_timer.is_valid()) {
+        ESP_LOGE(TAG, "No timer available; telemetry is disabled");
+    }
+}
+
+void ResourceTelemetry::end() {
+    _queue->cancel(_timer);
+    _timer = {};
+}
+
+void ResourceTelemetry::publish() {
+    if (!_mqtt_connection.is_connected()) {
+        return;
+    }
+
+    auto root = cJSON_CreateObject();
+    DEFER(cJSON_Delete(root));
+
+    cJSON_AddStringToObject(root, "entity_id", _device_entity_id.c_str());
+    cJSON_AddNumberToObject(root, "uptime", double(esp_get_millis() / 1000));
+
+    auto heap = cJSON_AddObjectToObject(root, "heap");
+    add_heap(heap, "internal", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    add_heap(heap, "dma", MALLOC_CAP_DMA);
+#if CONFIG_SPIRAM
+    add_heap(heap, "spiram", MALLOC_CAP_SPIRAM);
+#endif
+
+    add_tasks(root);
+    add_pools(root);
+    add_heap_accounts(root);
+
+    Metric::add_all_to_json(cJSON_AddObjectToObject(root, "metrics"));
+
+    auto json = cJSON_PrintUnformatted(root);
+    std::string payload(json);
+    cJSON_free(json);
+
+    // Telemetry is superseded by the next snapshot, so there's no point in retrying.
+    if (!_mqtt_connection.publish(CONFIG_MDM_TELEMETRY_TOPIC, payload, 0, false)) {
+        ESP_LOGW(TAG, "Failed to publish telemetry");
+    }
+}
+
+void ResourceTelemetry::add_heap(cJSON* parent, const char* name, uint32_t caps) {
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, caps);
+
+    // The largest free block against the free size shows how fragmented the heap is.
+    auto item = cJSON_AddObjectToObject(parent, name);
+    cJSON_AddNumberToObject(item, "free", double(info.total_free_bytes));
+    cJSON_AddNumberToObject(item, "largest", double(info.largest_free_block));
+    cJSON_AddNumberToObject(item, "min", double(info.minimum_free_bytes));
+}
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+
+void ResourceTelemetry::add_tasks(cJSON* parent) {
+    // Too large for the stack of the queue task.
+    const auto tasks = std::make_unique<TaskStatus_t[]>(MAX_TASKS);
+    uint32_t total_run_time = 0;
+    const auto count = uxTaskGetSystemState(tasks.get(), MAX_TASKS, &total_run_time);
+    if (!count) {
+        ESP_LOGW(TAG, "More than %d tasks; not sampling tasks", int(MAX_TASKS));
+        return;
+    }
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    // The run time counters keep running on every core.
+    const auto elapsed = uint64_t(total_run_time - _total_run_time) * portNUM_PROCESSORS;
+    const auto first_sample = _total_run_time == 0;
+    _total_run_time = total_run_time;
+
+    const auto run_times = std::make_unique<TaskRunTime[]>(count);
+#endif
+
+    auto items = cJSON_AddArrayToObject(parent, "tasks");
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        const auto& task = tasks[i];
+
+        auto item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "name", task.pcTaskName);
+        cJSON_AddNumberToObject(item, "stack", double(task.usStackHighWaterMark));
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+        const auto run_time = uint32_t(task.ulRunTimeCounter);
+        run_times[i] = {task.xHandle, run_time};
+
+        if (!first_sample && elapsed) {
+            // Tasks created since the previous snapshot count from zero.
+            const auto end = _run_times + _run_time_count;
+            const auto previous =
+                std::find_if(_run_times, end, [&task](auto& it) { return it.handle == task.xHandle; });
+            const auto delta = previous != end ? run_time - previous->run_time : run_time;
+
+            cJSON_AddNumberToObject(item, "cpu", double(delta * 1000ull / elapsed) / 10);
+        }
+#endif
+
+        cJSON_AddItemToArray(items, item);
+    }
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    std::copy_n(run_times.get(), count, _run_times);
+    _run_time_count = count;
+#endif
+}
+
+#else
+
+void ResourceTelemetry::add_tasks(cJSON* parent) {
+    auto items = cJSON_AddArrayToObject(parent, "tasks");
+
+    for (const auto name : KNOWN_TASKS) {
+        const auto handle = xTaskGetHandle(name);
+        if (!handle) {
+            continue;
+        }
+
+        auto item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "name", name);
+        cJSON_AddNumberToObject(item, "stack", double(uxTaskGetStackHighWaterMark(handle)));
+        cJSON_AddItemToArray(items, item);
+    }
+}
+
+#endif
+
+void ResourceTelemetry::add_pools(cJSON* parent) {
+    MemoryPoolStats stats[16];
+    const auto count = std::min(MemoryPool::get_all_stats(stats, std::size(stats)), std::size(stats));
+    if (!count) {
+        return;
+    }
+
+    auto items = cJSON_AddArrayToObject(parent, "pools");
+
+    for (size_t i = 0; i < count; i++) {
+        const auto& pool = stats[i];
+
+        auto item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "name", pool.name);
+        cJSON_AddNumberToObject(item, "in_use", pool.in_use);
+        cJSON_AddNumberToObject(item, "peak", pool.peak);
+        cJSON_AddNumberToObject(item, "failures", pool.failures);
+        cJSON_AddItemToArray(items, item);
+    }
+}
+
+void ResourceTelemetry::add_heap_accounts(cJSON* parent) {
+    HeapAccountStats stats[16];
+    const auto count = std::min(HeapAccount::get_all_stats(stats, std::size(stats)), std::size(stats));
+    if (!count) {
+        return;
+    }
+
+    auto items = cJSON_AddArrayToObject(parent, "heap_accounts");
+
+    for (size_t i = 0; i < count; i++) {
+        const auto& account = stats[i];
+
+        auto item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "name", account.name);
+        cJSON_AddNumberToObject(item, "live_bytes", account.live_bytes);
+        cJSON_AddNumberToObject(item, "peak_bytes", account.peak_bytes);
+        cJSON_AddNumberToObject(item, "allocations", account.allocations);
+        cJSON_AddNumberToObject(item, "frees", account.frees);
+        cJSON_AddItemToArray(items, item);
+    }
+}
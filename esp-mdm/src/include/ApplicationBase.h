@@ -6,12 +6,14 @@
 #include "MQTTConnection.h"
 #include "NetworkConnection.h"
 #include "Queue.h"
+#include "ResourceTelemetry.h"
 
 class ApplicationBase {
     NetworkConnection _network_connection;
     MQTTConnection _mqtt_connection;
     Queue _queue;
     LogManager _log_manager;
+    ResourceTelemetry _telemetry;
     MDMConfiguration _mdm_configuration;
     Callback<void> _begin;
     Callback<void> _network_available;
@@ -19,6 +21,7 @@ class ApplicationBase {
     Callback<void> _ready;
     Callback<cJSON*> _configuration_loaded;
     Callback<void> _process;
+    CallbackToken _connected_changed_token{};
     std::string _access_token;
     std::string _authorization;
     int64_t _token_expires_at{};
@@ -32,17 +35,30 @@ public:
 
     void begin();
     void process();
+    // Blocking variant of process(). Sleeps until there's work on the queue or a
+    // wake requested through get_queue().wake_after() is due.
+    void wait_and_process(uint32_t max_wait_ms = UINT32_MAX);
 
     const std::string& get_authorization();
     Queue& get_queue() { return _queue; }
     MQTTConnection& get_mqtt_connection() { return _mqtt_connection; }
     bool is_silent_startup() { return _silent_startup; }
+    // Publishes the events recorded by the tracer since the previous dump to
+    // MDM_TRACE_TOPIC. Concatenating the messages gives a Chrome trace.
+    esp_err_t publish_trace();
 
-    void on_begin(std::function<void()> func) { _begin.add(func); }
-    void on_network_available(std::function<void()> func) { _network_available.add(func); }
-    void on_network_connection_failed(std::function<void()> func) { _network_connection_failed.add(func); }
-    void on_ready(std::function<void()> func) { _ready.add(func); }
-    void on_configuration_loaded(std::function<void(cJSON*)> func) { _configuration_loaded.add(func); }
+    CallbackToken on_begin(Callback<void>::Function func) { return _begin.add(std::move(func)); }
+    CallbackToken on_network_available(Callback<void>::Function func) {
+        return _network_available.add(std::move(func));
+    }
+    CallbackToken on_network_connection_failed(Callback<void>::Function func) {
+        return _network_connection_failed.add(std::move(func));
+    }
+    CallbackToken on_ready(Callback<void>::Function func) { return _ready.add(std::move(func)); }
+    CallbackToken on_configuration_loaded(Callback<cJSON*>::Function func) {
+        return _configuration_loaded.add(std::move(func));
+    }
+    CallbackToken on_process(Callback<void>::Function func) { return _process.add(std::move(func)); }
 
 protected:
     virtual void do_begin() { _begin.call(); }
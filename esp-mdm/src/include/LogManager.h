@@ -8,14 +8,21 @@
 #include <string>
 #include <vector>
 
+#include "HeapAccount.h"
 #include "MQTTConnection.h"
 #include "Mutex.h"
-#include "Signal.h"
+#include "EventSignal.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 class LogManager {
+    // Reasons the task is woken up.
+    static constexpr EventBits_t EVENT_MESSAGE = 1 << 0;
+    static constexpr EventBits_t EVENT_CONNECTED = 1 << 1;
+    static constexpr EventBits_t EVENT_ENTITY_ID = 1 << 2;
+    static constexpr EventBits_t EVENT_SHUTDOWN = 1 << 3;
+
     struct Message {
         char* buffer;
 
@@ -24,17 +31,20 @@ class LogManager {
 
     static LogManager* _instance;
     static char* _buffer;
+    static HeapAccount _heap_account;
 
     MQTTConnection& _mqtt_connection;
     vprintf_like_t _default_log_handler{};
     Mutex _mutex;
-    std::vector<Message> _messages;
+    std::vector<Message, HeapAccountAllocator<Message, _heap_account>> _messages;
     std::string _device_entity_id;
     std::atomic<bool> _shutting_down{};
-    Signal _signal;
+    EventSignal _events;
     TaskHandle_t _task_handle{};
 
     static int log_handler(const char* message, va_list va);
+    static char* copy_message(const char* message, size_t length);
+    static void free_message(char* buffer);
 
 public:
     explicit LogManager(MQTTConnection& mqtt_connection);
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+
+#include "MQTTConnection.h"
+#include "Queue.h"
+#include "cJSON.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+// Periodically publishes a snapshot of the resources of the device: the stack high water
+// mark of the tasks, free heap versus the largest free block per memory capability, the
+// memory pools, all registered metrics (see Metrics.h), the heap accounts when heap
+// accounting is enabled (see HeapAccount.h) and, when FreeRTOS run time stats are
+// enabled, the CPU load of every task since the previous snapshot. Snapshots are skipped
+// while MQTT isn't connected.
+class ResourceTelemetry {
+    static constexpr size_t MAX_TASKS = 32;
+
+    struct TaskRunTime {
+        TaskHandle_t handle;
+        uint32_t run_time;
+    };
+
+    Queue* _queue;
+    MQTTConnection& _mqtt_connection;
+    std::string _device_entity_id;
+    TimerHandle _timer;
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    TaskRunTime _run_times[MAX_TASKS]{};
+    size_t _run_time_count{};
+    uint32_t _total_run_time{};
+#endif
+
+public:
+    ResourceTelemetry(Queue* queue, MQTTConnection& mqtt_connection)
+        : _queue(queue), _mqtt_connection(mqtt_connection) {}
+
+    ResourceTelemetry(const ResourceTelemetry&) = delete;
+    ResourceTelemetry& operator=(const ResourceTelemetry&) = delete;
+
+    // Starts publishing every interval_s seconds. Does nothing if it's already running or
+    // the interval is zero.
+    void begin(uint32_t interval_s = CONFIG_MDM_TELEMETRY_INTERVAL);
+    void end();
+    void set_device_entity_id(const std::string& device_entity_id) { _device_entity_id = device_entity_id; }
+
+    // Samples and publishes a snapshot right away.
+    void publish();
+
+private:
+    void add_heap(cJSON* parent, const char* name, uint32_t caps);
+    void add_tasks(cJSON* parent);
+    void add_pools(cJSON* parent);
+    void add_heap_accounts(cJSON* parent);
+};
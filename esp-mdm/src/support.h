@@ -3,6 +3,7 @@
 #include <memory>
 #include <string>
 
+#include "Clock.h"
 #include "defer.h"
 #include "error.h"
 #include "esp_check.h"
@@ -18,7 +19,7 @@
 #define ESP_TIMER_MS(v) ((v) * 1000)
 #define ESP_TIMER_SECONDS(v) ESP_TIMER_MS((v) * 1000)
 
-#define esp_get_millis() (esp_timer_get_time() / 1000ll)
+#define esp_get_millis() Clock::now_ms()
 
 int hextoi(char c);
 char const* esp_reset_reason_to_name(esp_reset_reason_t reason);
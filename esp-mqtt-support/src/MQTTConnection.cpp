@@ -4,6 +4,9 @@
 
 #include <charconv>
 
+#include "HeapAccount.h"
+#include "Metrics.h"
+#include "StringBuilder.h"
 #include "defer.h"
 #include "esp_mac.h"
 #include "esp_ota_ops.h"
@@ -21,6 +24,12 @@ LOG_TAG(MQTTConnection);
 
 #define MAXIMUM_PACKET_SIZE 4096
 
+static MetricCounter published_metric("mqtt.published");
+static MetricCounter publish_retries_metric("mqtt.publish_retries");
+static MetricCounter publish_failures_metric("mqtt.publish_failures");
+
+HeapAccount MQTTConnection::_heap_account("mqtt");
+
 MQTTConnection::MQTTConnection(Queue* queue) : _queue(queue), _device_id(get_device_id()) {}
 
 void MQTTConnection::begin() {
@@ -40,7 +49,7 @@ void MQTTConnection::begin() {
 
     _topic_prefix = CONFIG_MQTT_TOPIC_PREFIX "/" + _device_id + "/";
 
-    const auto state_topic = _topic_prefix + "state";
+    _state_topic = _topic_prefix + "state";
 
     esp_mqtt_client_config_t config = {
         .broker =
@@ -54,7 +63,7 @@ void MQTTConnection::begin() {
             {
                 .last_will =
                     {
-                        .topic = state_topic.c_str(),
+                        .topic = _state_topic.c_str(),
                         .msg = LAST_WILL_MESSAGE,
                         .qos = QOS_MIN_ONE,
                         .retain = true,
@@ -106,18 +115,26 @@ void MQTTConnection::event_handler(esp_event_base_t eventBase, int32_t eventId,
              esp_get_minimum_free_heap_size());
 
     switch ((esp_mqtt_event_id_t)eventId) {
-        case MQTT_EVENT_CONNECTED:
+        case MQTT_EVENT_CONNECTED: {
             ESP_LOGI(TAG, "MQTT connected");
             // On connect we're publishing a large number of messages for metadata.
             // We need to do this outside of the MQTT loop because otherwise we
-            // wouldn't be able to process in flight ACKs.
-            _queue->enqueue([this]() { handle_connected(); });
+            // wouldn't be able to process in flight ACKs. This runs in the bulk
+            // lane so it doesn't hold up user interaction.
+            const auto generation = ++_connection_generation;
+            _queue->enqueue([this, generation]() { handle_connected(generation); }, QueuePriority::Bulk);
             break;
+        }
 
         case MQTT_EVENT_DISCONNECTED:
             ESP_LOGI(TAG, "MQTT disconnected");
 
+            // Stops a discovery chain that's still running.
+            ++_connection_generation;
             _connected = false;
+            // Unsubscribing requires a connection. The timer is only touched on the queue task,
+            // where a discovery chain may be setting it right now.
+            _queue->enqueue([this]() { _queue->cancel(_discovery_unsubscribe_timer); });
             _connected_changed.queue(_queue, {false});
             break;
 
@@ -158,19 +175,45 @@ void MQTTConnection::event_handler(esp_event_base_t eventBase, int32_t eventId,
     }
 }
 
-void MQTTConnection::handle_connected() {
+void MQTTConnection::handle_connected(uint32_t generation) {
+    if (generation != _connection_generation) {
+        return;
+    }
+
     subscribe(_topic_prefix + "set/#");
 
     publish_configuration();
 
     _published_discovery_topics.clear();
-    _publish_discovery.call();
+
+    // Every discovery listener gets its own task so interactive work can run in between.
+    // The chain stops when the connection it was started for goes away.
+    _publish_discovery.queue_each(
+        _queue, QueuePriority::Bulk, [this, generation]() { handle_discovery_published(generation); },
+        [this, generation]() { return generation != _connection_generation; });
+}
+
+void MQTTConnection::handle_discovery_published(uint32_t generation) {
+    if (generation != _connection_generation) {
+        return;
+    }
 
     auto discovery_topic = strformat("homeassistant/+/%s/+/config", _device_id);
     subscribe(discovery_topic);
-    _queue->enqueue_delayed([this, discovery_topic]() { unsubscribe(discovery_topic); }, 60000);
+    _queue->cancel(_discovery_unsubscribe_timer);
+    _discovery_unsubscribe_timer =
+        _queue->enqueue_delayed([this, discovery_topic]() { unsubscribe(discovery_topic); }, 60000);
+    if (!_discovery_unsubscribe_timer.is_valid()) {
+        ESP_LOGW(TAG, "No timer available; staying subscribed to %s", discovery_topic.c_str());
+    }
 
     _connected = true;
+    // A disconnect that came in while this ran must win.
+    if (generation != _connection_generation) {
+        _connected = false;
+        return;
+    }
+
     _connected_changed.call({true});
 }
 
@@ -204,7 +247,7 @@ void MQTTConnection::handle_data(esp_mqtt_event_handle_t event) {
             return;
         }
 
-        auto sub_topic = topic.substr(_topic_prefix.length());
+        auto sub_topic = std::string_view(topic).substr(_topic_prefix.length());
 
         if (!sub_topic.starts_with("set/")) {
             ESP_LOGE(TAG, "Unknown topic %s", topic.c_str());
@@ -216,7 +259,7 @@ void MQTTConnection::handle_data(esp_mqtt_event_handle_t event) {
         if (it != _command_callbacks.end()) {
             it->second(data);
         } else {
-            ESP_LOGW(TAG, "No callback registered for object_id '%s'", object_id.c_str());
+            ESP_LOGW(TAG, "No callback registered for object_id '%.*s'", int(object_id.length()), object_id.data());
         }
     });
 }
@@ -242,13 +285,13 @@ void MQTTConnection::unsubscribe(const std::string& topic) {
 void MQTTConnection::publish_configuration() {
     ESP_LOGI(TAG, "Publishing configuration information");
 
-    auto uniqueIdentifier = strformat("%s_%s", CONFIG_MQTT_TOPIC_PREFIX, _device_id);
+    StringBuilder unique_identifier("%s_%s", CONFIG_MQTT_TOPIC_PREFIX, _device_id);
 
     auto root = cJSON_CreateObject();
     ESP_ASSERT_CHECK(root);
     DEFER(cJSON_Delete(root));
 
-    cJSON_AddStringToObject(root, "unique_id", uniqueIdentifier.c_str());
+    cJSON_AddStringToObject(root, "unique_id", unique_identifier.c_str());
 
     auto device = cJSON_AddObjectToObject(root, "device");
     cJSON_AddStringToObject(device, "manufacturer", CONFIG_MQTT_DEVICE_MANUFACTURER);
@@ -256,20 +299,20 @@ void MQTTConnection::publish_configuration() {
     cJSON_AddStringToObject(device, "name", _configuration.device_name.c_str());
     cJSON_AddStringToObject(device, "firmware_version", get_firmware_version().c_str());
 
-    publish_json(root, _topic_prefix + "configuration", true);
+    publish_json(root, StringBuilder("%sconfiguration", _topic_prefix).c_str(), true);
 }
 
-void MQTTConnection::publish_json(cJSON* root, const std::string& topic, bool retain) {
+void MQTTConnection::publish_json(cJSON* root, const char* topic, bool retain) {
     auto json = cJSON_PrintUnformatted(root);
 
-    publish_with_retry(topic.c_str(), json, 0, QOS_MIN_ONE, retain);
+    publish_with_retry(topic, json, 0, QOS_MIN_ONE, retain);
 
     cJSON_free(json);
 }
 
 void MQTTConnection::publish_button_discovery(MQTTDiscovery metadata, std::function<void()> command_func) {
     publish_discovery("button", metadata, [this, command_func](auto json, auto object_id) {
-        cJSON_AddStringToObject(json, "command_topic", (_topic_prefix + "set/" + object_id).c_str());
+        cJSON_AddStringToObject(json, "command_topic", StringBuilder("%sset/%s", _topic_prefix, object_id).c_str());
         cJSON_AddStringToObject(json, "payload_press", "true");
 
         register_callback(object_id, [command_func](auto data) {
@@ -285,7 +328,7 @@ void MQTTConnection::publish_button_discovery(MQTTDiscovery metadata, std::funct
 void MQTTConnection::publish_sensor_discovery(MQTTDiscovery metadata, MQTTSensorDiscovery component_metadata) {
     publish_discovery("sensor", metadata, [this, component_metadata](auto json, auto object_id) {
         cJSON_AddStringToObject(json, "state_class", component_metadata.state_class);
-        cJSON_AddStringToObject(json, "state_topic", (_topic_prefix + "state").c_str());
+        cJSON_AddStringToObject(json, "state_topic", _state_topic.c_str());
         cJSON_AddStringToObject(json, "unit_of_measurement", component_metadata.unit_of_measurement);
         cJSON_AddStringToObject(json, "value_template", component_metadata.value_template);
     });
@@ -294,10 +337,10 @@ void MQTTConnection::publish_sensor_discovery(MQTTDiscovery metadata, MQTTSensor
 void MQTTConnection::publish_switch_discovery(MQTTDiscovery metadata, MQTTSwitchDiscovery component_metadata,
                                               std::function<void(bool)> command_func) {
     publish_discovery("switch", metadata, [this, component_metadata, command_func](auto json, auto object_id) {
-        cJSON_AddStringToObject(json, "command_topic", (_topic_prefix + "set/" + object_id).c_str());
+        cJSON_AddStringToObject(json, "command_topic", StringBuilder("%sset/%s", _topic_prefix, object_id).c_str());
         cJSON_AddStringToObject(json, "payload_on", "on");
         cJSON_AddStringToObject(json, "payload_off", "off");
-        cJSON_AddStringToObject(json, "state_topic", (_topic_prefix + "state").c_str());
+        cJSON_AddStringToObject(json, "state_topic", _state_topic.c_str());
         cJSON_AddStringToObject(json, "value_template", component_metadata.value_template);
 
         register_callback(object_id, [command_func](auto data) {
@@ -317,7 +360,7 @@ void MQTTConnection::publish_binary_sensor_discovery(MQTTDiscovery metadata,
     publish_discovery("binary_sensor", metadata, [this, component_metadata](auto json, auto object_id) {
         cJSON_AddBoolToObject(json, "payload_on", true);
         cJSON_AddBoolToObject(json, "payload_off", false);
-        cJSON_AddStringToObject(json, "state_topic", (_topic_prefix + "state").c_str());
+        cJSON_AddStringToObject(json, "state_topic", _state_topic.c_str());
         cJSON_AddStringToObject(json, "value_template", component_metadata.value_template);
     });
 }
@@ -331,8 +374,8 @@ void MQTTConnection::publish_number_discovery(MQTTDiscovery metadata, MQTTNumber
         cJSON_AddNumberToObject(json, "min", component_metadata.min);
         cJSON_AddNumberToObject(json, "max", component_metadata.max);
         cJSON_AddNumberToObject(json, "step", component_metadata.step);
-        cJSON_AddStringToObject(json, "command_topic", (_topic_prefix + "set/" + object_id).c_str());
-        cJSON_AddStringToObject(json, "state_topic", (_topic_prefix + "state").c_str());
+        cJSON_AddStringToObject(json, "command_topic", StringBuilder("%sset/%s", _topic_prefix, object_id).c_str());
+        cJSON_AddStringToObject(json, "state_topic", _state_topic.c_str());
         cJSON_AddStringToObject(json, "value_template", component_metadata.value_template);
 
         register_callback(object_id, command_func);
@@ -350,7 +393,7 @@ void MQTTConnection::publish_device_automation(MQTTDeviceAutomationDiscovery met
     cJSON_AddStringToObject(root, "automation_type", "trigger");
     cJSON_AddStringToObject(root, "payload", metadata.trigger_value);
     cJSON_AddStringToObject(root, "subtype", metadata.trigger_value);
-    cJSON_AddStringToObject(root, "topic", (_topic_prefix + metadata.trigger_name).c_str());
+    cJSON_AddStringToObject(root, "topic", StringBuilder("%s%s", _topic_prefix, metadata.trigger_name).c_str());
     cJSON_AddStringToObject(root, "type", metadata.trigger_name);
 
     add_device_metadata(root, metadata.subdevice_id, metadata.subdevice_name);
@@ -358,7 +401,7 @@ void MQTTConnection::publish_device_automation(MQTTDeviceAutomationDiscovery met
     auto topic = strformat("homeassistant/device_automation/%s/%s_%s/config", _device_id, metadata.trigger_name,
                            metadata.trigger_value);
     _published_discovery_topics.insert(topic);
-    publish_json(root, topic, true);
+    publish_json(root, topic.c_str(), true);
 }
 
 void MQTTConnection::publish_discovery(const char* component, const MQTTDiscovery& metadata,
@@ -385,8 +428,7 @@ void MQTTConnection::publish_discovery(const char* component, const MQTTDiscover
     const auto availability_item = cJSON_CreateObject();
     cJSON_AddItemToArray(availability, availability_item);
 
-    cJSON_AddStringToObject(availability_item, "topic",
-                            strformat(CONFIG_MQTT_TOPIC_PREFIX "/%s/state", _device_id).c_str());
+    cJSON_AddStringToObject(availability_item, "topic", _state_topic.c_str());
     cJSON_AddStringToObject(availability_item, "value_template", "{{ value_json.online }}");
     cJSON_AddBoolToObject(availability_item, "payload_available", true);
 
@@ -394,11 +436,16 @@ void MQTTConnection::publish_discovery(const char* component, const MQTTDiscover
 
     add_device_metadata(root, metadata.subdevice_id, metadata.subdevice_name);
 
-    const auto object_id = metadata.subdevice_id ? strformat("%s_%s", metadata.subdevice_id, metadata.object_id)
-                                                 : std::string(metadata.object_id);
+    StringBuilder<64> object_id;
+    if (metadata.subdevice_id) {
+        object_id.append(metadata.subdevice_id).append('_');
+    }
+    object_id.append(metadata.object_id);
 
-    cJSON_AddStringToObject(root, "unique_id", strformat("%s_%s_%s", _device_id, component, object_id).c_str());
-    cJSON_AddStringToObject(root, "object_id", strformat("%s_%s", _configuration.device_entity_id, object_id).c_str());
+    cJSON_AddStringToObject(root, "unique_id",
+                            StringBuilder("%s_%s_%s", _device_id, component, object_id.c_str()).c_str());
+    cJSON_AddStringToObject(root, "object_id",
+                            StringBuilder("%s_%s", _configuration.device_entity_id, object_id.c_str()).c_str());
 
     if (!metadata.enabled_by_default) {
         cJSON_AddBoolToObject(root, "enabled_by_default", false);
@@ -406,19 +453,19 @@ void MQTTConnection::publish_discovery(const char* component, const MQTTDiscover
 
     func(root, object_id.c_str());
 
-    auto topic = strformat("homeassistant/%s/%s/%s/config", component, _device_id, object_id);
+    auto topic = strformat("homeassistant/%s/%s/%s/config", component, _device_id, object_id.c_str());
     _published_discovery_topics.insert(topic);
-    publish_json(root, topic, true);
+    publish_json(root, topic.c_str(), true);
 }
 
 void MQTTConnection::add_device_metadata(cJSON* root, const char* subdevice_id, const char* subdevice_name) {
     const auto device = cJSON_AddObjectToObject(root, "device");
 
-    auto device_identifier = strformat("%s_%s", CONFIG_MQTT_TOPIC_PREFIX, _device_id);
+    StringBuilder device_identifier("%s_%s", CONFIG_MQTT_TOPIC_PREFIX, _device_id);
     if (subdevice_id) {
         cJSON_AddStringToObject(device, "via_device", device_identifier.c_str());
 
-        device_identifier += strformat("_%s", subdevice_id);
+        device_identifier.append('_').append(subdevice_id);
     }
 
     const auto identifiers = cJSON_AddArrayToObject(device, "identifiers");
@@ -476,8 +523,7 @@ void MQTTConnection::send_state(cJSON* data) {
 
     auto json = cJSON_PrintUnformatted(data);
 
-    auto topic = _topic_prefix + "state";
-    publish_with_retry(topic.c_str(), json, 0, QOS_MIN_ONE, true);
+    publish_with_retry(_state_topic.c_str(), json, 0, QOS_MIN_ONE, true);
 
     cJSON_free(json);
 }
@@ -487,7 +533,7 @@ void MQTTConnection::send_trigger(const char* name, const char* value) {
 
     ESP_ASSERT_CHECK(_client);
 
-    auto topic = _topic_prefix + name;
+    StringBuilder topic("%s%s", _topic_prefix, name);
     publish_with_retry(topic.c_str(), value, 0, QOS_MIN_ONE, false);
 }
 
@@ -523,15 +569,18 @@ int MQTTConnection::publish_with_retry(const char* topic, const char* data, int
     for (int attempt = 0; attempt < MAX_RETRIES; attempt++) {
         auto result = esp_mqtt_client_publish(_client, topic, data, len, qos, retain);
         if (result >= 0) {
+            published_metric.increment();
             return result;
         }
 
         if (attempt < MAX_RETRIES - 1) {
+            publish_retries_metric.increment();
             ESP_LOGD(TAG, "Publish failed (attempt %d/%d), retrying in %dms", attempt + 1, MAX_RETRIES, RETRY_DELAY_MS);
             vTaskDelay(pdMS_TO_TICKS(RETRY_DELAY_MS));
         }
     }
 
+    publish_failures_metric.increment();
     ESP_LOGW(TAG, "Publish to %s failed after %d attempts", topic, MAX_RETRIES);
     return -1;
 }
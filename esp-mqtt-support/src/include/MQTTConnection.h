@@ -1,10 +1,12 @@
 #pragma once
 
+#include <atomic>
 #include <map>
 #include <set>
 #include <string>
 
 #include "Callback.h"
+#include "HeapAccount.h"
 #include "Queue.h"
 #include "Span.h"
 #include "cJSON.h"
@@ -67,18 +69,34 @@ class MQTTConnection {
 
     static std::string get_device_id();
 
+    // Charged with the nodes of the topic maps and sets; the topic strings themselves
+    // aren't.
+    static HeapAccount _heap_account;
+
+    using TopicCallback = std::function<void(const std::string&)>;
+    // Transparent comparators so topics can be looked up by string_view.
+    using CallbackMap = std::map<std::string, TopicCallback, std::less<>,
+                                 HeapAccountAllocator<std::pair<const std::string, TopicCallback>, _heap_account>>;
+    using TopicSet = std::set<std::string, std::less<std::string>, HeapAccountAllocator<std::string, _heap_account>>;
+
     Queue* _queue;
     std::string _device_id;
     MQTTConfiguration _configuration;
     std::string _topic_prefix;
+    std::string _state_topic;
     esp_mqtt_client_handle_t _client{};
     Callback<MQTTConnectionState> _connected_changed;
     Callback<void> _publish_discovery;
-    std::map<std::string, std::function<void(const std::string&)>> _command_callbacks;
-    std::map<std::string, std::function<void(const std::string&)>> _topic_callbacks;
-    std::set<std::string> _published_discovery_topics;
-    bool _connected{};
+    CallbackMap _command_callbacks;
+    CallbackMap _topic_callbacks;
+    TopicSet _published_discovery_topics;
+    std::atomic<bool> _connected{};
+    // Changes on every connect and disconnect, so work queued for an earlier connection
+    // can tell it's stale.
+    std::atomic<uint32_t> _connection_generation{};
     int64_t _last_qos_publish_time{};
+    // Only accessed on the queue task.
+    TimerHandle _discovery_unsubscribe_timer;
 
 public:
     MQTTConnection(Queue* queue);
@@ -90,8 +108,13 @@ public:
     void send_state();
     void send_state(cJSON* data);
     void send_trigger(const char* name, const char* value);
-    void on_connected_changed(std::function<void(MQTTConnectionState)> func) { _connected_changed.add(func); }
-    void on_publish_discovery(std::function<void()> func) { _publish_discovery.add(func); }
+    CallbackToken on_connected_changed(Callback<MQTTConnectionState>::Function func) {
+        return _connected_changed.add(std::move(func));
+    }
+    bool remove_connected_changed(CallbackToken token) { return _connected_changed.remove(token); }
+    CallbackToken on_publish_discovery(Callback<void>::Function func) {
+        return _publish_discovery.add(std::move(func));
+    }
     void subscribe(const std::string& topic, std::function<void(const std::string&)> callback);
     void register_callback(const char* object_id, std::function<void(const std::string&)> callback);
     void publish_button_discovery(MQTTDiscovery metadata, std::function<void()> command_func);
@@ -105,12 +128,13 @@ public:
 
 private:
     void event_handler(esp_event_base_t eventBase, int32_t eventId, void* eventData);
-    void handle_connected();
+    void handle_connected(uint32_t generation);
+    void handle_discovery_published(uint32_t generation);
     void handle_data(esp_mqtt_event_handle_t event);
     void subscribe(const std::string& topic);
     void unsubscribe(const std::string& topic);
     void publish_configuration();
-    void publish_json(cJSON* root, const std::string& topic, bool retain);
+    void publish_json(cJSON* root, const char* topic, bool retain);
     void publish_discovery(const char* component, const MQTTDiscovery& metadata,
                            std::function<void(cJSON* json, const char* object_id)> func);
     bool handle_discovery_prune(const std::string& topic, bool empty_message);
@@ -5,32 +5,69 @@
 LOG_TAG(http_support);
 
 esp_err_t esp_http_get_response(esp_http_client_handle_t client, std::string& target, size_t max_length) {
-    target.clear();
+    constexpr size_t CHUNK_SIZE = 1024;
 
-    constexpr size_t BUFFER_SIZE = 1024;
-    const auto bufferSize = max_length > 0 ? std::min(max_length + 1, BUFFER_SIZE) : BUFFER_SIZE;
-
-    auto buffer = std::make_unique<char[]>(bufferSize);
+    // Read straight into the string instead of going through a separate buffer.
+    size_t length = 0;
 
     while (true) {
-        auto read = esp_http_client_read(client, buffer.get(), bufferSize);
+        // Leave room for one more byte than allowed so we notice the response is too long.
+        auto chunk_size = CHUNK_SIZE;
+        if (max_length > 0) {
+            chunk_size = std::min(chunk_size, max_length + 1 - length);
+        }
+
+        target.resize(length + chunk_size);
+
+        auto read = esp_http_client_read(client, target.data() + length, int(chunk_size));
         if (read < 0) {
+            target.clear();
             ESP_ERROR_RETURN(-read);
         }
         if (read == 0) {
             break;
         }
 
-        if (max_length > 0 && target.length() + read > max_length) {
+        length += read;
+
+        if (max_length > 0 && length > max_length) {
+            target.clear();
             ESP_ERROR_RETURN(ESP_ERR_INVALID_SIZE);
         }
-
-        target.append(buffer.get(), read);
     }
 
+    target.resize(length);
+
     return ESP_OK;
 }
 
+esp_err_t esp_http_get_response(esp_http_client_handle_t client, ByteSpan target, size_t& length) {
+    length = 0;
+
+    while (true) {
+        if (length == target.size()) {
+            // Check whether there's more data than fits.
+            char extra;
+            auto read = esp_http_client_read(client, &extra, 1);
+            if (read < 0) {
+                ESP_ERROR_RETURN(-read);
+            }
+            return read == 0 ? ESP_OK : ESP_ERR_INVALID_SIZE;
+        }
+
+        auto remaining = target.subspan(length);
+        auto read = esp_http_client_read(client, (char*)remaining.data(), int(remaining.size()));
+        if (read < 0) {
+            ESP_ERROR_RETURN(-read);
+        }
+        if (read == 0) {
+            return ESP_OK;
+        }
+
+        length += read;
+    }
+}
+
 esp_err_t esp_http_get_json(esp_http_client_handle_t client, cJSON*& data, size_t max_length) {
     std::string json;
     ESP_ERROR_RETURN(esp_http_get_response(client, json, max_length));
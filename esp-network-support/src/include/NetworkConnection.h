@@ -30,7 +30,9 @@ public:
     NetworkConnection(Queue* synchronizationQueue);
 
     esp_err_t begin(const char* ssid, const char* password);
-    void on_state_changed(std::function<void(NetworkConnectionState)> func) { _state_changed.add(func); }
+    CallbackToken on_state_changed(Callback<NetworkConnectionState>::Function func) {
+        return _state_changed.add(std::move(func));
+    }
     std::string get_ip_address();
 
 private:
@@ -2,8 +2,12 @@
 
 #include <string>
 
+#include "Span.h"
 #include "cJSON.h"
 #include "esp_http_client.h"
 
 esp_err_t esp_http_get_response(esp_http_client_handle_t client, std::string& target, size_t max_length);
+// Reads the response into a caller provided buffer. Fails with ESP_ERR_INVALID_SIZE if
+// the response doesn't fit.
+esp_err_t esp_http_get_response(esp_http_client_handle_t client, ByteSpan target, size_t& length);
 esp_err_t esp_http_get_json(esp_http_client_handle_t client, cJSON*& data, size_t max_length);
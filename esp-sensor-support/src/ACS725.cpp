@@ -5,15 +5,17 @@
 #include <cmath>
 #include <cstdlib>
 
-#include "NVSProperty.h"
+#include "Metrics.h"
 #include "freertos/portmacro.h"
 #include "freertos/task.h"
 #include "soc/soc_caps.h"
 
 LOG_TAG(ACS725);
 
-static NVSPropertyF32 nvs_zero_mv("zero_mv");
-static NVSPropertyF32 nvs_noise_floor_a("noise_a");
+static MetricCounter frames_metric("acs725.frames");
+static MetricCounter read_errors_metric("acs725.read_errors");
+static MetricCounter clipped_metric("acs725.clipped_samples");
+static MetricGauge current_metric("acs725.current_a");
 
 // -------------------- USER-TUNABLE COMPILE-TIME CONFIG --------------------
 
@@ -127,8 +129,10 @@ void ACS725::task_loop() {
         esp_err_t err = adc_continuous_read(_adc_handle, buffer, sizeof(buffer), &bytes_read, portMAX_DELAY);
 
         if (err == ESP_OK && bytes_read > 0) {
+            frames_metric.increment();
             process_samples(buffer, bytes_read);
         } else if (err != ESP_ERR_TIMEOUT) {
+            read_errors_metric.increment();
             ESP_LOGW(TAG, "adc_continuous_read failed: %s", esp_err_to_name(err));
             vTaskDelay(pdMS_TO_TICKS(10));
         }
@@ -136,30 +140,18 @@ void ACS725::task_loop() {
 }
 
 void ACS725::load_state() {
-    _zero_mv = 0;
-    _noise_floor_a = 0;
+    ESP_ERROR_CHECK(_store.load());
 
-    nvs_handle_t handle;
-    auto err = nvs_open("acs725", NVS_READONLY, &handle);
-    if (err == ESP_ERR_NVS_NOT_FOUND) {
-        return;
-    }
-    ESP_ERROR_CHECK(err);
-
-    _zero_mv = nvs_zero_mv.get(handle, 0);
-    _noise_floor_a = nvs_noise_floor_a.get(handle, 0);
-
-    nvs_close(handle);
+    _zero_mv = _nvs_zero_mv.get();
+    _noise_floor_a = _nvs_noise_floor_a.get();
 }
 
 void ACS725::save_state() {
-    nvs_handle_t handle;
-    ESP_ERROR_CHECK(nvs_open("acs725", NVS_READWRITE, &handle));
+    _nvs_zero_mv.set(_zero_mv);
+    _nvs_noise_floor_a.set(_noise_floor_a);
 
-    nvs_zero_mv.set(handle, _zero_mv);
-    nvs_noise_floor_a.set(handle, _noise_floor_a);
-
-    nvs_close(handle);
+    // Calibration only happens once, so don't wait for the commit delay.
+    ESP_ERROR_CHECK(_store.flush());
 }
 
 void ACS725::process_samples(const uint8_t* buffer, uint32_t len) {
@@ -221,6 +213,7 @@ void ACS725::process_samples(const uint8_t* buffer, uint32_t len) {
             }
 
             if (clipped) {
+                clipped_metric.increment(uint32_t(clipped));
                 ESP_LOGW(TAG, "%d samples clipped", clipped);
             }
 
@@ -242,7 +235,10 @@ void ACS725::process_samples(const uint8_t* buffer, uint32_t len) {
             const bool report = rms_raw >= 2 * NOISE_FLOOR;
             const float rms = std::sqrt(std::max(0.0f, rms_raw_squared - NOISE_FLOOR * NOISE_FLOOR));
 
-            ESP_LOGI(TAG,
+            current_metric.set(rms);
+
+            // The current is reported through the acs725.current_a metric.
+            ESP_LOGD(TAG,
                      "Report %.4fA (raw %.4f, noise floor %.4f, Watt %.1f) mean %.1f mean offset %.1f reporting %s",
                      rms, rms_raw, NOISE_FLOOR, rms * ASSUMED_VOLTAGE, mean, _zero_mv - mean,
                      report ? "YES" : "NO - below threshold of 2 x noise floor");
@@ -58,7 +58,7 @@ esp_err_t SEN0626::begin(int sda_pin, int scl_pin, int int_pin) {
 
     // 6. Create background task.
     xTaskCreate([](void* self) { ((SEN0626*)self)->task_loop(); }, "sen0626", CONFIG_MAIN_TASK_STACK_SIZE, this, 2,
-                &_task_handle);
+                nullptr);
 
     // 7. Install GPIO ISR service (may already be installed).
     esp_err_t isr_err = gpio_install_isr_service(0);
@@ -77,14 +77,12 @@ esp_err_t SEN0626::begin(int sda_pin, int scl_pin, int int_pin) {
 
 void IRAM_ATTR SEN0626::isr_handler(void* arg) {
     auto* self = (SEN0626*)arg;
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    vTaskNotifyGiveFromISR(self->_task_handle, &xHigherPriorityTaskWoken);
-    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    self->_interrupt.signal_from_isr();
 }
 
 void SEN0626::task_loop() {
     while (true) {
-        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        _interrupt.wait();
 
         uint16_t type = _gfd->getGestureType();
         uint16_t score = _gfd->getGestureScore();
@@ -4,6 +4,7 @@
 
 #include "ACS725Calibration.h"
 #include "Callback.h"
+#include "NVSStore.h"
 #include "esp_adc/adc_cali.h"
 #include "esp_adc/adc_continuous.h"
 #include "esp_err.h"
@@ -22,20 +23,27 @@ class ACS725 {
     float _zero_mv{};
     float _noise_floor_a{};
 
+    NVSStore _store;
+    NVSCachedProperty<float> _nvs_zero_mv{&_store, "zero_mv"};
+    NVSCachedProperty<float> _nvs_noise_floor_a{&_store, "noise_a"};
+
     float* _ring{};
     size_t _ring_size{};
     size_t _ring_idx{};
 
-    Callback<float> _current_changed;
+    CoalescedCallback<float> _current_changed;
 
 public:
-    ACS725(Queue* queue) : _queue(queue) {}
+    ACS725(Queue* queue) : _queue(queue), _store("acs725", queue) {}
 
     // report_interval_ms: interval at which the current is reported
     esp_err_t begin(int pin, uint32_t report_interval_ms);
 
     // Register a callback to get notified of RMS current (A) measurement samples.
-    void on_current_changed(std::function<void(float)> func) { _current_changed.add(func); }
+    CallbackToken on_current_changed(Callback<float>::Function func) { return _current_changed.add(std::move(func)); }
+
+    // Number of measurements that were superseded before the queue got to them.
+    uint32_t get_dropped_reports() const { return _current_changed.get_dropped(); }
 
 private:
     void task_loop();
@@ -22,7 +22,7 @@ class LDR {
     size_t _sample_count{};
     size_t _samples_needed{};
 
-    Callback<float> _lux_changed;
+    CoalescedCallback<float> _lux_changed;
 
 public:
     // divider_resistance: the fixed resistor in the voltage divider (ohms)
@@ -36,7 +36,10 @@ public:
 
     esp_err_t begin(int pin, uint32_t report_interval_ms);
 
-    void on_lux_changed(std::function<void(float)> func) { _lux_changed.add(func); }
+    CallbackToken on_lux_changed(Callback<float>::Function func) { return _lux_changed.add(std::move(func)); }
+
+    // Number of measurements that were superseded before the queue got to them.
+    uint32_t get_dropped_reports() const { return _lux_changed.get_dropped(); }
 
 private:
     void task_loop();
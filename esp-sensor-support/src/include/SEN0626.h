@@ -4,6 +4,7 @@
 #include <functional>
 
 #include "Callback.h"
+#include "Signal.h"
 #include "esp_err.h"
 #include "driver/i2c_master.h"
 #include "freertos/FreeRTOS.h"
@@ -21,7 +22,7 @@ class SEN0626 {
     DFRobot_GestureFaceDetection_I2C* _gfd{};
     i2c_master_bus_handle_t _bus_handle{};
     i2c_master_dev_handle_t _dev_handle{};
-    TaskHandle_t _task_handle{};
+    Signal _interrupt;
 
     Callback<GestureEvent> _gesture_detected;
 
@@ -30,7 +31,9 @@ public:
 
     esp_err_t begin(int sda_pin, int scl_pin, int int_pin);
 
-    void on_gesture_detected(std::function<void(GestureEvent)> func) { _gesture_detected.add(func); }
+    CallbackToken on_gesture_detected(Callback<GestureEvent>::Function func) {
+        return _gesture_detected.add(std::move(func));
+    }
 
 private:
     static void IRAM_ATTR isr_handler(void* arg);
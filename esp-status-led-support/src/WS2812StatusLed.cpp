@@ -2,6 +2,7 @@
 
 #include "WS2812StatusLed.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include "led_strip.h"
@@ -78,6 +79,18 @@ void WS2812StatusLed::process() {
     }
 }
 
+uint32_t WS2812StatusLed::get_process_delay_ms() {
+    const int64_t next_update_ms = _next_update_ms;
+
+    if (get_mode() == StatusLedMode::Off || next_update_ms == 0) {
+        return UINT32_MAX;
+    }
+
+    const int64_t delay = next_update_ms - esp_get_millis();
+
+    return uint32_t(std::clamp(delay, int64_t(0), int64_t(UINT32_MAX - 1)));
+}
+
 void WS2812StatusLed::config_changed() {
     const auto period = get_period();
 
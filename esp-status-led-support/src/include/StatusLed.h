@@ -16,6 +16,9 @@ public:
 
     virtual void begin() = 0;
     virtual void process() = 0;
+    // Milliseconds until process() needs to be called again, or UINT32_MAX if the
+    // LED doesn't need servicing.
+    virtual uint32_t get_process_delay_ms() { return UINT32_MAX; }
 
     void set_mode(StatusLedMode mode, uint32_t period = 0) {
         _mode = mode;
@@ -14,6 +14,7 @@ class WS2812StatusLed : public RGBStatusLed, public BrightnessStatusLed {
 public:
     void begin() override;
     void process() override;
+    uint32_t get_process_delay_ms() override;
 
 protected:
     void config_changed() override;
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "Clock.h"
 #include "error.h"
 #include "esp_log.h"
 #include "esp_timer.h"
@@ -13,4 +14,4 @@
 
 #define LOG_TAG(v) [[maybe_unused]] static const char* TAG = #v
 
-#define esp_get_millis() (esp_timer_get_time() / 1000ll)
+#define esp_get_millis() Clock::now_ms()
@@ -0,0 +1,134 @@
+import argparse, pathlib, struct, zlib
+
+# Must match AssetPartition.h.
+MAGIC = 0x54455341
+VERSION = 1
+# Set in the header if a partition without index holds an LZSS stream, and in the entry
+# of every asset that's stored as one.
+FLAG_COMPRESSED = 1
+HEADER = struct.Struct("<IBBHII")
+NAME_SIZE = 23
+ENTRY = struct.Struct("<{}sBII".format(NAME_SIZE))
+ALIGNMENT = 4
+
+# Must match LzssDecoder.h.
+WINDOW_SIZE = 1 << 10
+LENGTH_BITS = 6
+MIN_MATCH = 3
+MAX_MATCH = MIN_MATCH + (1 << LENGTH_BITS) - 1
+# Number of earlier positions with the same prefix that are tried for a match.
+MAX_CANDIDATES = 64
+
+
+def compress(data):
+    out = bytearray(struct.pack("<I", len(data)))
+    chains = {}
+    flags_pos = 0
+    flag_bit = 8
+    pos = 0
+
+    while pos < len(data):
+        if flag_bit == 8:
+            flags_pos = len(out)
+            out.append(0)
+            flag_bit = 0
+
+        best_length = 0
+        best_distance = 0
+        prefix = data[pos : pos + MIN_MATCH]
+        candidates = chains.get(prefix, []) if len(prefix) == MIN_MATCH else []
+
+        for candidate in reversed(candidates):
+            distance = pos - candidate
+            if distance > WINDOW_SIZE:
+                break
+            length = MIN_MATCH
+            limit = min(MAX_MATCH, len(data) - pos)
+            while length < limit and data[candidate + length] == data[pos + length]:
+                length += 1
+            if length > best_length:
+                best_length, best_distance = length, distance
+                if length == limit:
+                    break
+
+        step = best_length if best_length else 1
+        if best_length:
+            out += struct.pack("<H", (best_distance - 1) << LENGTH_BITS | (best_length - MIN_MATCH))
+        else:
+            out[flags_pos] |= 1 << flag_bit
+            out.append(data[pos])
+        flag_bit += 1
+
+        for i in range(pos, min(pos + step, len(data) - MIN_MATCH + 1)):
+            chain = chains.setdefault(data[i : i + MIN_MATCH], [])
+            chain.append(i)
+            if len(chain) > MAX_CANDIDATES:
+                del chain[0]
+        pos += step
+
+    return bytes(out)
+
+
+parser = argparse.ArgumentParser(description="Build an asset partition image")
+parser.add_argument("size", type=lambda v: int(v, 0))
+parser.add_argument("output")
+parser.add_argument("--index", action="store_true", help="Pack the files with an index of their names")
+parser.add_argument("--compress", action="store_true", help="Compress the files for LzssDecoder")
+parser.add_argument("files", nargs="+")
+args = parser.parse_args()
+
+
+# Returns the content to store and its flags. Content that doesn't get smaller, like
+# data that's compressed already, is stored as is.
+def read(file):
+    content = pathlib.Path(file).read_bytes()
+    if not args.compress:
+        return content, 0
+
+    compressed = compress(content)
+    if len(compressed) >= len(content):
+        print("Stored {} raw, compressing would grow it to {} bytes".format(file, len(compressed)))
+        return content, 0
+
+    print("Compressed {} from {} to {} bytes".format(file, len(content), len(compressed)))
+    return compressed, FLAG_COMPRESSED
+
+
+if args.index:
+    names = [pathlib.Path(file).name for file in args.files]
+    for name in names:
+        if len(name.encode()) >= NAME_SIZE:
+            raise Exception("Asset name {} is too long".format(name))
+    if len(set(names)) != len(names):
+        raise Exception("Asset names must be unique")
+
+    # The index comes first; asset offsets are relative to its start.
+    data = bytearray()
+    index = bytearray()
+    offset = ENTRY.size * len(args.files)
+
+    for name, file in zip(names, args.files):
+        content, entry_flags = read(file)
+        index += ENTRY.pack(name.encode(), entry_flags, offset + len(data), len(content))
+        data += content
+        data += b"\x00" * (-len(data) % ALIGNMENT)
+
+    payload = bytes(index + data)
+    count = len(args.files)
+    flags = 0
+else:
+    if len(args.files) != 1:
+        raise Exception("Pass --index to pack more than one file")
+
+    payload, flags = read(args.files[0])
+    count = 0
+
+image = HEADER.pack(MAGIC, VERSION, flags, count, len(payload), zlib.crc32(payload)) + payload
+if len(image) > args.size:
+    raise Exception("Assets of {} bytes do not fit in size {}".format(len(image), args.size))
+
+# Pad. Compressed images are left short, so flashing them only writes what's in use.
+if not args.compress:
+    image += b"\x00" * (args.size - len(image))
+
+pathlib.Path(args.output).write_bytes(image)
@@ -1,11 +1,21 @@
 # PUBLIC FUNCTION
 #   raw_partition(
 #       NAME        <partition-name>
-#       GENERATOR   <script> [ARGS …]
+#       FILE        <file>                        # or ASSETS
+#       HEADER                                    # prefix FILE with a header
+#       ASSETS      <list-of-files>               # pack files with an index
+#       COMPRESS                                  # LZSS compress FILE or ASSETS
 #       SIZE        <bytes> | AUTO                # default=AUTO (from CSV)
 #       DEPENDS     <list-of-extra-deps>
 #   )
 #
+# With HEADER or ASSETS, the image gets the header (and index) that the
+# AssetPartition class validates and maps at runtime. Assets are named after
+# their file name. COMPRESS implies HEADER; compressed assets are read back
+# through LzssDecoder. Assets that don't get smaller are stored uncompressed and
+# flagged as such. Compressed images aren't padded, so only the part of the
+# partition that's in use is flashed.
+#
 # It builds the binary, pads/truncates it, and wires it into:
 #   - its own `${NAME}-flash` target
 #   - the global `flash` target used by idf.py
@@ -13,9 +23,9 @@
 cmake_policy(SET CMP0057 NEW)             # allow IN_LIST in if()
 
 function(raw_partition)
-    set(options)                          # none
+    set(options HEADER COMPRESS)
     set(oneValueArgs NAME SIZE FILE)
-    set(multiValueArgs DEPENDS)
+    set(multiValueArgs DEPENDS ASSETS)
 
     cmake_parse_arguments(RP "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
 
@@ -23,8 +33,11 @@ function(raw_partition)
     if(NOT RP_NAME)
         message(FATAL_ERROR "raw_partition(): NAME is mandatory")
     endif()
-    if(NOT RP_FILE)
-        message(FATAL_ERROR "raw_partition(): FILE is mandatory")
+    if(NOT RP_FILE AND NOT RP_ASSETS)
+        message(FATAL_ERROR "raw_partition(): FILE or ASSETS is mandatory")
+    endif()
+    if(RP_FILE AND RP_ASSETS)
+        message(FATAL_ERROR "raw_partition(): FILE and ASSETS are mutually exclusive")
     endif()
 
     # --- partition size ----------------------------------------------------
@@ -35,12 +48,33 @@ function(raw_partition)
 
     set(out_bin ${CMAKE_BINARY_DIR}/${RP_NAME}.bin)
 
-    add_custom_command(OUTPUT ${out_bin}
-        COMMAND ${PYTHON} ${ESP_SUPPORT_TOOL_DIR}/pad.py
-        ${RP_FILE} ${RP_SIZE} ${out_bin}
-        DEPENDS ${RP_FILE} ${RP_DEPENDS}
-        COMMENT "Copy ${RP_FILE} to ${out_bin}"
-    )
+    set(asset_args)
+    if(RP_COMPRESS)
+        list(APPEND asset_args --compress)
+    endif()
+
+    if(RP_ASSETS)
+        add_custom_command(OUTPUT ${out_bin}
+            COMMAND ${PYTHON} ${ESP_SUPPORT_TOOL_DIR}/asset_partition.py
+            ${RP_SIZE} ${out_bin} --index ${asset_args} ${RP_ASSETS}
+            DEPENDS ${ESP_SUPPORT_TOOL_DIR}/asset_partition.py ${RP_ASSETS} ${RP_DEPENDS}
+            COMMENT "Pack assets into ${out_bin}"
+        )
+    elseif(RP_HEADER OR RP_COMPRESS)
+        add_custom_command(OUTPUT ${out_bin}
+            COMMAND ${PYTHON} ${ESP_SUPPORT_TOOL_DIR}/asset_partition.py
+            ${RP_SIZE} ${out_bin} ${asset_args} ${RP_FILE}
+            DEPENDS ${ESP_SUPPORT_TOOL_DIR}/asset_partition.py ${RP_FILE} ${RP_DEPENDS}
+            COMMENT "Copy ${RP_FILE} with header to ${out_bin}"
+        )
+    else()
+        add_custom_command(OUTPUT ${out_bin}
+            COMMAND ${PYTHON} ${ESP_SUPPORT_TOOL_DIR}/pad.py
+            ${RP_FILE} ${RP_SIZE} ${out_bin}
+            DEPENDS ${RP_FILE} ${RP_DEPENDS}
+            COMMENT "Copy ${RP_FILE} to ${out_bin}"
+        )
+    endif()
 
     # convenience ALL-target so IDEs build it automatically
     add_custom_target(${RP_NAME}_bin ALL DEPENDS ${out_bin})
@@ -0,0 +1,73 @@
+#include "Callback.h"
+#include "host_test.h"
+
+static void test_queue_each() {
+    Queue queue;
+    Callback<void> callback;
+
+    int calls = 0;
+    callback.add([&calls] { calls++; });
+    callback.add([&calls] { calls++; });
+
+    auto done = false;
+    callback.queue_each(&queue, QueuePriority::Bulk, [&done] { done = true; });
+    queue.process();
+
+    CHECK(calls == 2);
+    CHECK(done);
+
+    // The tasks of the chain fit the inline storage of a slot, even with a done task and
+    // a cancelled predicate.
+    uint32_t generation = 1;
+    done = false;
+    callback.queue_each(
+        &queue, QueuePriority::Bulk, [&done] { done = true; }, [&generation] { return generation != 1; });
+    queue.process();
+
+    CHECK(calls == 4);
+    CHECK(done);
+    CHECK(queue.get_stats().oversized == 0);
+}
+
+static void test_queue_each_cancelled() {
+    Queue queue;
+    Callback<void> callback;
+
+    // Listeners run newest first. The first one simulates a connection that drops while
+    // it runs.
+    uint32_t generation = 1;
+    int calls = 0;
+    callback.add([&calls] { calls++; });
+    const auto token = callback.add([&calls] { calls++; });
+    callback.add([&] {
+        calls++;
+        generation++;
+    });
+
+    auto done = false;
+    const auto started = generation;
+    callback.queue_each(
+        &queue, QueuePriority::Bulk, [&done] { done = true; },
+        [&generation, started] { return generation != started; });
+    queue.process();
+
+    CHECK(calls == 1);
+    CHECK(!done);
+
+    // The chain released the list, so removing frees the listener right away and a
+    // new chain runs the rest.
+    CHECK(callback.remove(token));
+
+    callback.queue_each(&queue, QueuePriority::Bulk, [&done] { done = true; });
+    queue.process();
+
+    CHECK(calls == 3);
+    CHECK(done);
+}
+
+int main() {
+    test_queue_each();
+    test_queue_each_cancelled();
+
+    return 0;
+}
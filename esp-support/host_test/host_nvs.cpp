@@ -0,0 +1,210 @@
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "host_nvs.h"
+#include "nvs.h"
+
+namespace {
+
+enum class EntryType { Integer, String, Blob };
+
+struct Entry {
+    EntryType type;
+    std::vector<uint8_t> data;
+};
+
+struct Handle {
+    std::string name_space;
+    nvs_open_mode_t open_mode;
+};
+
+std::mutex lock;
+// Committed and pending writes aren't told apart; the tests only count commits.
+std::map<std::string, std::map<std::string, Entry>> namespaces;
+std::map<nvs_handle_t, Handle> handles;
+nvs_handle_t next_handle = 1;
+HostNvsStats stats;
+esp_err_t set_error = ESP_OK;
+esp_err_t commit_error = ESP_OK;
+
+Handle* get_handle(nvs_handle_t handle) {
+    const auto it = handles.find(handle);
+    return it == handles.end() ? nullptr : &it->second;
+}
+
+esp_err_t set(nvs_handle_t handle, const char* key, EntryType type, const void* data, size_t length) {
+    std::lock_guard guard(lock);
+
+    const auto entry = get_handle(handle);
+    if (!entry || entry->open_mode != NVS_READWRITE) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (set_error != ESP_OK) {
+        return set_error;
+    }
+
+    auto bytes = (const uint8_t*)data;
+    namespaces[entry->name_space][key] = {type, std::vector<uint8_t>(bytes, bytes + length)};
+    stats.writes++;
+
+    return ESP_OK;
+}
+
+esp_err_t get(nvs_handle_t handle, const char* key, EntryType type, std::vector<uint8_t>& data) {
+    std::lock_guard guard(lock);
+
+    const auto entry = get_handle(handle);
+    if (!entry) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+
+    auto& values = namespaces[entry->name_space];
+    const auto it = values.find(key);
+    if (it == values.end() || it->second.type != type) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    data = it->second.data;
+    return ESP_OK;
+}
+
+template <typename T>
+esp_err_t get_integer(nvs_handle_t handle, const char* key, T* value) {
+    std::vector<uint8_t> data;
+    const auto err = get(handle, key, EntryType::Integer, data);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (data.size() != sizeof(T)) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    memcpy(value, data.data(), sizeof(T));
+    return ESP_OK;
+}
+
+// Strings and blobs have the same length semantics.
+esp_err_t get_variable(nvs_handle_t handle, const char* key, EntryType type, void* out_value, size_t* length) {
+    std::vector<uint8_t> data;
+    const auto err = get(handle, key, type, data);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (!out_value) {
+        *length = data.size();
+        return ESP_OK;
+    }
+    if (*length < data.size()) {
+        *length = data.size();
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+
+    memcpy(out_value, data.data(), data.size());
+    *length = data.size();
+    return ESP_OK;
+}
+
+}  // namespace
+
+esp_err_t nvs_open(const char* name_space, nvs_open_mode_t open_mode, nvs_handle_t* out_handle) {
+    std::lock_guard guard(lock);
+
+    if (open_mode == NVS_READONLY && !namespaces.contains(name_space)) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    *out_handle = next_handle++;
+    handles[*out_handle] = {name_space, open_mode};
+
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    std::lock_guard guard(lock);
+
+    handles.erase(handle);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    std::lock_guard guard(lock);
+
+    if (!get_handle(handle)) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (commit_error != ESP_OK) {
+        return commit_error;
+    }
+
+    stats.commits++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+    std::lock_guard guard(lock);
+
+    const auto entry = get_handle(handle);
+    if (!entry) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+
+    return namespaces[entry->name_space].erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+#define NVS_DEFINE_INTEGER(name, type)                                             \
+    esp_err_t nvs_get_##name(nvs_handle_t handle, const char* key, type* value) {  \
+        return get_integer(handle, key, value);                                    \
+    }                                                                              \
+    esp_err_t nvs_set_##name(nvs_handle_t handle, const char* key, type value) {   \
+        return set(handle, key, EntryType::Integer, &value, sizeof(value));        \
+    }
+
+NVS_DEFINE_INTEGER(i8, int8_t)
+NVS_DEFINE_INTEGER(u8, uint8_t)
+NVS_DEFINE_INTEGER(i16, int16_t)
+NVS_DEFINE_INTEGER(u16, uint16_t)
+NVS_DEFINE_INTEGER(i32, int32_t)
+NVS_DEFINE_INTEGER(u32, uint32_t)
+NVS_DEFINE_INTEGER(i64, int64_t)
+NVS_DEFINE_INTEGER(u64, uint64_t)
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out_value, size_t* length) {
+    return get_variable(handle, key, EntryType::String, out_value, length);
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value) {
+    return set(handle, key, EntryType::String, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length) {
+    return get_variable(handle, key, EntryType::Blob, out_value, length);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length) {
+    return set(handle, key, EntryType::Blob, value, length);
+}
+
+HostNvsStats host_nvs_get_stats() {
+    std::lock_guard guard(lock);
+
+    return stats;
+}
+
+void host_nvs_set_failure(esp_err_t set_err, esp_err_t commit_err) {
+    std::lock_guard guard(lock);
+
+    set_error = set_err;
+    commit_error = commit_err;
+}
+
+void host_nvs_reset() {
+    std::lock_guard guard(lock);
+
+    namespaces.clear();
+    stats = {};
+    set_error = ESP_OK;
+    commit_error = ESP_OK;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+#include "esp_err.h"
+
+// Inspection of the in-memory NVS behind the stand-in nvs.h.
+struct HostNvsStats {
+    // Number of set calls.
+    uint32_t writes;
+    uint32_t commits;
+};
+
+HostNvsStats host_nvs_get_stats();
+// Makes set calls and commits fail with the errors until they're set back to ESP_OK.
+// Failed calls don't change the store or the statistics.
+void host_nvs_set_failure(esp_err_t set_error, esp_err_t commit_error);
+// Erases everything and resets the statistics and failures.
+void host_nvs_reset();
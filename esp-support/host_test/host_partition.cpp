@@ -0,0 +1,102 @@
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "host_partition.h"
+
+namespace {
+
+struct Partition {
+    esp_partition_t info;
+    std::vector<uint8_t> data;
+};
+
+// Nodes of a map don't move, so partitions can be handed out by pointer.
+std::map<std::string, Partition> partitions;
+
+Partition* get_partition(const esp_partition_t* info) {
+    const auto it = partitions.find(info->label);
+    return it == partitions.end() ? nullptr : &it->second;
+}
+
+}  // namespace
+
+bool host_partition_load(const char* label, const char* path, uint32_t size) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file || strlen(label) >= sizeof(esp_partition_t::label)) {
+        return false;
+    }
+
+    std::vector<uint8_t> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    if (data.size() > size) {
+        return false;
+    }
+    // Erased flash.
+    data.resize(size, 0xff);
+
+    auto& partition = partitions[label];
+    partition.info = {ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, size, {}};
+    strcpy(partition.info.label, label);
+    partition.data = std::move(data);
+
+    return true;
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label) {
+    for (const auto& [name, partition] : partitions) {
+        if (partition.info.type == type && (subtype == ESP_PARTITION_SUBTYPE_ANY || partition.info.subtype == subtype) &&
+            (!label || name == label)) {
+            return &partition.info;
+        }
+    }
+
+    return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* info, size_t src_offset, void* dst, size_t size) {
+    const auto partition = get_partition(info);
+    if (!partition) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (src_offset > partition->data.size() || size > partition->data.size() - src_offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memcpy(dst, partition->data.data() + src_offset, size);
+    return ESP_OK;
+}
+
+// Mapping hands out a pointer into the image; there's nothing to unmap.
+esp_err_t esp_partition_mmap(const esp_partition_t* info, size_t offset, size_t size, esp_partition_mmap_memory_t,
+                             const void** out_ptr, esp_partition_mmap_handle_t* out_handle) {
+    const auto partition = get_partition(info);
+    if (!partition) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset > partition->data.size() || size > partition->data.size() - offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    *out_ptr = partition->data.data() + offset;
+    *out_handle = 0;
+    return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t) {}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+
+// Data partitions behind the stand-in esp_partition.h.
+
+// Registers a data partition with the label, holding the image file padded to size.
+// Returns false if the file can't be read or doesn't fit.
+bool host_partition_load(const char* label, const char* path, uint32_t size);
@@ -0,0 +1,145 @@
+// Compares raw and LZSS compressed asset partitions: the flash they take, the time it
+// takes to flash them, and how fast LzssDecoder decompresses the assets.
+//
+//   lzss_benchmark <raw image> <compressed image> [rounds]
+//
+// The images are built by asset_partition.py from the same files, without and with
+// --compress. The raw image is padded to the partition size, like it's flashed.
+// Decompression runs on the host CPU, so compare its throughput between runs rather
+// than with a device.
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "AssetPartition.h"
+#include "LzssDecoder.h"
+#include "host_partition.h"
+#include "host_test.h"
+
+// Rate at which esptool erases and writes flash at 921600 baud. It depends on the flash
+// chip and the serial link, so flashing times are estimates.
+static constexpr double FLASH_BYTES_PER_S = 90 * 1024;
+static constexpr size_t SECTOR_SIZE = 4096;
+// Decompressing through a small buffer, like firmware streaming an asset.
+static constexpr size_t CHUNK_SIZE = 256;
+
+static size_t file_size(const char* path) {
+    auto file = fopen(path, "rb");
+    CHECK(file);
+    fseek(file, 0, SEEK_END);
+    const auto size = size_t(ftell(file));
+    fclose(file);
+    return size;
+}
+
+// Flash is erased and written in whole sectors.
+static double flash_time_s(size_t size) {
+    return double((size + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE) / FLASH_BYTES_PER_S;
+}
+
+static std::vector<uint8_t> decompress(ByteView input) {
+    LzssDecoder decoder(input);
+    std::vector<uint8_t> output;
+    uint8_t chunk[CHUNK_SIZE];
+
+    while (!decoder.is_done()) {
+        size_t length;
+        CHECK(decoder.read(chunk, length) == ESP_OK);
+        output.insert(output.end(), chunk, chunk + length);
+    }
+
+    return output;
+}
+
+// Every asset reads back the same from both partitions.
+static void verify(const AssetPartition& raw, const AssetPartition& compressed) {
+    CHECK(raw.get_count() == compressed.get_count());
+
+    for (size_t i = 0; i < compressed.get_count(); i++) {
+        const auto expected = raw.find(compressed.get_name(i));
+        CHECK(!raw.is_compressed(i));
+
+        if (compressed.is_compressed(i)) {
+            const auto output = decompress(compressed.get(i));
+            CHECK(ByteView(output.data(), output.size()) == expected);
+        } else {
+            CHECK(compressed.get(i) == expected);
+        }
+    }
+}
+
+static void compare_size(const AssetPartition& raw, const AssetPartition& compressed, size_t raw_image_size,
+                         size_t compressed_image_size) {
+    size_t raw_total = 0;
+    size_t stored_total = 0;
+
+    printf("%-16s %8s %8s\n", "asset", "raw", "stored");
+    for (size_t i = 0; i < compressed.get_count(); i++) {
+        const auto name = compressed.get_name(i);
+        const auto raw_size = raw.find(name).size();
+        const auto stored_size = compressed.get(i).size();
+
+        printf("%-16.*s %8zu %8zu%s\n", int(name.size()), name.data(), raw_size, stored_size,
+               compressed.is_compressed(i) ? "" : "  stored raw");
+        raw_total += raw_size;
+        stored_total += stored_size;
+    }
+    printf("%-16s %8zu %8zu  %.1f%%\n", "total", raw_total, stored_total, 100.0 * stored_total / raw_total);
+
+    printf("flashing raw:        %8zu bytes, %.2f s\n", raw_image_size, flash_time_s(raw_image_size));
+    printf("flashing compressed: %8zu bytes, %.2f s\n", compressed_image_size, flash_time_s(compressed_image_size));
+}
+
+static void bench_decompress(const AssetPartition& compressed, int rounds) {
+    uint8_t chunk[CHUNK_SIZE];
+
+    for (size_t i = 0; i < compressed.get_count(); i++) {
+        if (!compressed.is_compressed(i)) {
+            continue;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        size_t total = 0;
+
+        for (int round = 0; round < rounds; round++) {
+            LzssDecoder decoder(compressed.get(i));
+            while (!decoder.is_done()) {
+                size_t length;
+                CHECK(decoder.read(chunk, length) == ESP_OK);
+                total += length;
+            }
+        }
+
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const auto name = compressed.get_name(i);
+
+        printf("decompress %-16.*s %8.1f MB/s\n", int(name.size()), name.data(), total / seconds / 1e6);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <raw image> <compressed image> [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    const auto rounds = argc > 3 ? std::stoi(argv[3]) : 200;
+    const auto raw_image_size = file_size(argv[1]);
+    const auto compressed_image_size = file_size(argv[2]);
+
+    // Both partitions have the size of the raw image.
+    CHECK(host_partition_load("raw", argv[1], uint32_t(raw_image_size)));
+    CHECK(host_partition_load("compressed", argv[2], uint32_t(raw_image_size)));
+
+    AssetPartition raw;
+    AssetPartition compressed;
+    CHECK(raw.begin("raw") == ESP_OK);
+    CHECK(compressed.begin("compressed") == ESP_OK);
+
+    verify(raw, compressed);
+    compare_size(raw, compressed, raw_image_size, compressed_image_size);
+    bench_decompress(compressed, rounds);
+
+    return 0;
+}
@@ -0,0 +1,39 @@
+# Writes the inputs of lzss_benchmark: assets like the ones firmware keeps in raw
+# partitions. LZSS shrinks the gamma table, the screen and the text; the sine table and
+# the random data are stored raw.
+#
+#   lzss_benchmark_assets.py <output dir>
+import math, pathlib, random, struct, sys
+
+out = pathlib.Path(sys.argv[1])
+out.mkdir(parents=True, exist_ok=True)
+
+# 8 bit gamma correction table with long runs.
+gamma = bytes(round(255 * (i / 4095) ** 2.2) for i in range(4096))
+(out / "gamma.bin").write_bytes(gamma)
+
+# 16 bit sine table.
+table = b"".join(struct.pack("<h", round(32767 * math.sin(2 * math.pi * i / 8192))) for i in range(8192))
+(out / "sine.bin").write_bytes(table)
+
+# RGB565 screen with a background, panels and some text-like noise.
+WIDTH, HEIGHT = 240, 160
+rng = random.Random(1)
+pixels = [0x2104] * (WIDTH * HEIGHT)
+for panel in range(6):
+    x0, y0 = rng.randrange(WIDTH - 60), rng.randrange(HEIGHT - 40)
+    color = rng.randrange(0x10000)
+    for y in range(y0, y0 + 40):
+        for x in range(x0, x0 + 60):
+            pixels[y * WIDTH + x] = color
+for _ in range(1500):
+    pixels[rng.randrange(WIDTH * HEIGHT)] = 0xFFFF
+(out / "screen.rgb565").write_bytes(struct.pack("<{}H".format(len(pixels)), *pixels))
+
+# JSON-like configuration text.
+lines = ['{{"id": {}, "name": "sensor_{}", "unit": "{}", "min": {}, "max": {}}},'.format(
+    i, i, rng.choice(["C", "%", "hPa", "lx"]), rng.randrange(-40, 0), rng.randrange(50, 1000)) for i in range(400)]
+(out / "sensors.json").write_bytes(("[\n" + "\n".join(lines) + "\n]\n").encode())
+
+# Already compressed or encrypted data.
+(out / "random.bin").write_bytes(rng.randbytes(32 * 1024))
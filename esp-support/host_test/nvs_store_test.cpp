@@ -0,0 +1,148 @@
+#include "Clock.h"
+#include "NVSStore.h"
+#include "host_nvs.h"
+#include "host_test.h"
+
+static constexpr uint32_t COMMIT_DELAY_MS = 100;
+
+static void test_batched_flush() {
+    host_nvs_reset();
+
+    Queue queue;
+    VirtualClock clock;
+    Clock::install(&clock);
+
+    NVSStore store("test", &queue, COMMIT_DELAY_MS);
+    NVSCachedProperty<uint32_t> level(&store, "level");
+    NVSCachedProperty<float> energy(&store, "energy");
+    CHECK(store.load() == ESP_OK);
+
+    for (uint32_t i = 1; i <= 10; i++) {
+        level.set(i);
+        energy.set(float(i) / 2);
+        queue.process();
+    }
+    CHECK(store.is_dirty());
+    CHECK(host_nvs_get_stats().commits == 0);
+
+    clock.advance_ms(COMMIT_DELAY_MS);
+    queue.process();
+
+    // A burst of changes costs a write per property and a single commit.
+    CHECK(!store.is_dirty());
+    CHECK(host_nvs_get_stats().writes == 2);
+    CHECK(host_nvs_get_stats().commits == 1);
+
+    NVSStore reloaded("test");
+    NVSCachedProperty<uint32_t> reloaded_level(&reloaded, "level");
+    NVSCachedProperty<float> reloaded_energy(&reloaded, "energy");
+    CHECK(reloaded.load() == ESP_OK);
+    CHECK(reloaded_level.get() == 10);
+    CHECK(reloaded_energy.get() == 5.0f);
+
+    Clock::install(nullptr);
+}
+
+static void test_flush_without_timer() {
+    host_nvs_reset();
+
+    Queue queue;
+    VirtualClock clock;
+    Clock::install(&clock);
+
+    // Use up all timers.
+    TimerHandle timers[CONFIG_ESP_SUPPORT_QUEUE_MAX_TIMERS];
+    for (auto& timer : timers) {
+        timer = queue.enqueue_delayed([] {}, 60000);
+        CHECK(timer.is_valid());
+    }
+
+    NVSStore store("test", &queue, COMMIT_DELAY_MS);
+    NVSCachedProperty<uint32_t> level(&store, "level");
+    CHECK(store.load() == ESP_OK);
+
+    level.set(42);
+
+    // Without a timer the flush is queued right away instead of being lost.
+    queue.process();
+
+    CHECK(!store.is_dirty());
+    CHECK(host_nvs_get_stats().commits == 1);
+
+    // A later change gets a flush of its own.
+    CHECK(queue.cancel(timers[0]));
+
+    level.set(43);
+    queue.process();
+    CHECK(store.is_dirty());
+
+    clock.advance_ms(COMMIT_DELAY_MS);
+    queue.process();
+    CHECK(!store.is_dirty());
+    CHECK(host_nvs_get_stats().commits == 2);
+
+    for (auto& timer : timers) {
+        queue.cancel(timer);
+    }
+
+    Clock::install(nullptr);
+}
+
+static void test_flush_failure() {
+    host_nvs_reset();
+
+    Queue queue;
+    VirtualClock clock;
+    Clock::install(&clock);
+
+    NVSStore store("test", &queue, COMMIT_DELAY_MS);
+    NVSCachedProperty<uint32_t> level(&store, "level");
+    NVSCachedProperty<float> energy(&store, "energy");
+    CHECK(store.load() == ESP_OK);
+
+    // A failed write keeps the property dirty and retries later.
+    host_nvs_set_failure(ESP_ERR_NVS_NOT_ENOUGH_SPACE, ESP_OK);
+    level.set(1);
+    clock.advance_ms(COMMIT_DELAY_MS);
+    queue.process();
+    CHECK(level.is_dirty());
+    CHECK(host_nvs_get_stats().writes == 0);
+
+    host_nvs_set_failure(ESP_OK, ESP_OK);
+    clock.advance_ms(COMMIT_DELAY_MS);
+    queue.process();
+    CHECK(!store.is_dirty());
+    CHECK(host_nvs_get_stats().writes == 1);
+    CHECK(host_nvs_get_stats().commits == 1);
+
+    // So does a failed commit, for everything that was written.
+    host_nvs_set_failure(ESP_OK, ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+    level.set(2);
+    energy.set(2.5f);
+    CHECK(store.flush() == ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+    CHECK(level.is_dirty());
+    CHECK(energy.is_dirty());
+
+    host_nvs_set_failure(ESP_OK, ESP_OK);
+    clock.advance_ms(COMMIT_DELAY_MS);
+    queue.process();
+    CHECK(!store.is_dirty());
+    CHECK(host_nvs_get_stats().commits == 2);
+
+    NVSStore reloaded("test");
+    NVSCachedProperty<uint32_t> reloaded_level(&reloaded, "level");
+    NVSCachedProperty<float> reloaded_energy(&reloaded, "energy");
+    CHECK(reloaded.load() == ESP_OK);
+    CHECK(reloaded_level.get() == 2);
+    CHECK(reloaded_energy.get() == 2.5f);
+
+    Clock::install(nullptr);
+}
+
+int main() {
+    test_batched_flush();
+    test_flush_without_timer();
+    test_flush_failure();
+
+    return 0;
+}
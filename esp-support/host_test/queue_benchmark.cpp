@@ -0,0 +1,161 @@
+// Measures enqueue/process throughput and the accuracy of delayed tasks of the host Queue,
+// so queue changes can be compared on a Linux box before they reach devices.
+//
+//   queue_benchmark [task count]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Queue.h"
+
+static int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static double elapsed_s(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Enqueues and processes from the same thread, in batches that fit the queue.
+static void bench_single_thread(uint32_t count) {
+    Queue queue;
+    uint32_t runs = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < count; i += CONFIG_ESP_SUPPORT_QUEUE_LENGTH) {
+        for (uint32_t j = 0; j < CONFIG_ESP_SUPPORT_QUEUE_LENGTH; j++) {
+            queue.enqueue([&runs] { runs++; });
+        }
+        queue.process();
+    }
+
+    const auto seconds = elapsed_s(start);
+
+    printf("single thread:   %9.0f tasks/s (%" PRIu32 " tasks)\n", runs / seconds, runs);
+}
+
+// A producer thread enqueues while the processing thread waits in wait_and_process(),
+// which is how applications drive the queue.
+static void bench_producer_consumer(uint32_t count, bool oversized) {
+    Queue queue;
+    std::atomic<uint32_t> runs{};
+    std::atomic<bool> stop{};
+
+    std::thread consumer([&] {
+        while (!stop.load()) {
+            queue.wait_and_process(10);
+        }
+    });
+
+    // Captures past the inline storage of a slot move the task to the heap.
+    uint8_t payload[CONFIG_ESP_SUPPORT_QUEUE_TASK_INLINE_SIZE]{};
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (oversized) {
+            queue.enqueue([&runs, payload] { runs.fetch_add(payload[0] + 1); });
+        } else {
+            queue.enqueue([&runs] { runs.fetch_add(1); });
+        }
+    }
+    while (runs.load() < count) {
+        std::this_thread::yield();
+    }
+
+    const auto seconds = elapsed_s(start);
+
+    stop = true;
+    queue.enqueue([] {});
+    consumer.join();
+
+    const auto stats = queue.get_stats();
+
+    printf("%s %9.0f tasks/s, latency avg %" PRIu32 " us, max %" PRIu32 " us\n",
+           oversized ? "oversized tasks:" : "two threads:    ", count / seconds, stats.lanes[0].latency_avg_us,
+           stats.lanes[0].latency_max_us);
+}
+
+// Schedules delayed tasks and reports how late they ran.
+static void bench_delayed_accuracy() {
+    static constexpr uint32_t DELAYS_MS[] = {1, 5, 10, 50, 100};
+    static constexpr int REPEAT = 3;
+
+    Queue queue;
+    std::vector<int64_t> lateness_us;
+    int pending = 0;
+
+    for (int repeat = 0; repeat < REPEAT; repeat++) {
+        for (const auto delay_ms : DELAYS_MS) {
+            const auto due = now_us() + int64_t(delay_ms) * 1000;
+
+            queue.enqueue_delayed(
+                [&, due] {
+                    lateness_us.push_back(now_us() - due);
+                    pending--;
+                },
+                delay_ms);
+            pending++;
+        }
+
+        while (pending) {
+            queue.wait_and_process();
+        }
+    }
+
+    std::sort(lateness_us.begin(), lateness_us.end());
+
+    int64_t total = 0;
+    for (const auto value : lateness_us) {
+        total += value;
+    }
+
+    printf("delayed tasks:   late avg %" PRIi64 " us, median %" PRIi64 " us, max %" PRIi64 " us (%zu tasks)\n",
+           total / int64_t(lateness_us.size()), lateness_us[lateness_us.size() / 2], lateness_us.back(),
+           lateness_us.size());
+}
+
+// A periodic task keeps its cadence instead of drifting by its own lateness.
+static void bench_periodic_drift() {
+    static constexpr uint32_t INTERVAL_MS = 10;
+    static constexpr int RUNS = 50;
+
+    Queue queue;
+    int runs = 0;
+    int64_t last = 0;
+
+    const auto start = now_us();
+    const auto handle = queue.enqueue_periodic(
+        [&] {
+            runs++;
+            last = now_us();
+        },
+        INTERVAL_MS);
+
+    while (runs < RUNS) {
+        queue.wait_and_process();
+    }
+    queue.cancel(handle);
+
+    printf("periodic tasks:  drift after %d runs of %" PRIu32 " ms: %" PRIi64 " us\n", RUNS, INTERVAL_MS,
+           last - start - int64_t(RUNS) * INTERVAL_MS * 1000);
+}
+
+int main(int argc, char** argv) {
+    const auto count = argc > 1 ? uint32_t(std::stoul(argv[1])) : 1000000u;
+
+    bench_single_thread(count);
+    bench_producer_consumer(count, false);
+    bench_producer_consumer(count / 10, true);
+    bench_delayed_accuracy();
+    bench_periodic_drift();
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "Clock.h"
+#include "Queue.h"
+#include "host_test.h"
+
+static void test_timers_exhausted() {
+    Queue queue;
+    VirtualClock clock;
+    Clock::install(&clock);
+
+    int runs = 0;
+    TimerHandle handles[CONFIG_ESP_SUPPORT_QUEUE_MAX_TIMERS];
+    for (auto& handle : handles) {
+        handle = queue.enqueue_delayed([&runs] { runs++; }, 100);
+        CHECK(handle.is_valid());
+    }
+
+    // All timers are in use, so this one is dropped instead of aborting.
+    auto dropped = false;
+    const auto overflow = queue.enqueue_delayed([&dropped] { dropped = true; }, 100);
+    CHECK(!overflow.is_valid());
+    CHECK(!queue.cancel(overflow));
+
+    clock.advance_ms(100);
+    queue.process();
+
+    CHECK(runs == CONFIG_ESP_SUPPORT_QUEUE_MAX_TIMERS);
+    CHECK(!dropped);
+
+    // The timers are free again.
+    const auto handle = queue.enqueue_delayed([&runs] { runs++; }, 100);
+    CHECK(handle.is_valid());
+    CHECK(queue.cancel(handle));
+
+    Clock::install(nullptr);
+}
+
+static void test_periodic(uint32_t interval_ms) {
+    Queue queue;
+    VirtualClock clock;
+    Clock::install(&clock);
+
+    int runs = 0;
+    const auto handle = queue.enqueue_periodic([&runs] { runs++; }, interval_ms);
+    CHECK(handle.is_valid());
+
+    clock.advance_ms(interval_ms - 1);
+    queue.process();
+    CHECK(runs == 0);
+
+    clock.advance_ms(1);
+    queue.process();
+    CHECK(runs == 1);
+
+    clock.advance_ms(interval_ms - 1);
+    queue.process();
+    CHECK(runs == 1);
+
+    clock.advance_ms(1);
+    queue.process();
+    CHECK(runs == 2);
+
+    CHECK(queue.cancel(handle));
+
+    Clock::install(nullptr);
+}
+
+int main() {
+    test_timers_exhausted();
+
+    test_periodic(1000);
+    // Periods that don't fit 32 bits of microseconds.
+    test_periodic(2 * 60 * 60 * 1000);
+    // 2^32 * 125 microseconds, which used to truncate to a one-shot timer.
+    test_periodic(536870912);
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+// Stress tests for the lock-free ring buffers. Build with -DHOST_TEST_SANITIZER=thread to
+// have ThreadSanitizer check the slot accesses as well.
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "RingBuffer.h"
+#include "host_test.h"
+
+static constexpr uint32_t ITEMS = 50000;
+
+// Large enough to be copied in several steps, so a torn copy shows up as a mismatch.
+struct Item {
+    uint32_t producer;
+    uint32_t sequence;
+    uint32_t check[6];
+
+    static Item make(uint32_t producer, uint32_t sequence) {
+        Item item{producer, sequence, {}};
+        for (uint32_t i = 0; i < 6; i++) {
+            item.check[i] = (sequence ^ producer) * (i + 1);
+        }
+        return item;
+    }
+
+    bool is_intact() const { return *this == make(producer, sequence); }
+
+    bool operator==(const Item&) const = default;
+};
+
+// Pushes single items and batches alternately, yielding while the buffer is full.
+template <typename Buffer>
+static void produce(Buffer& buffer, uint32_t producer, uint32_t count) {
+    uint32_t sequence = 0;
+    while (sequence < count) {
+        if (sequence % 2) {
+            Item batch[5];
+            const auto size = std::min(uint32_t(5), count - sequence);
+            for (uint32_t i = 0; i < size; i++) {
+                batch[i] = Item::make(producer, sequence + i);
+            }
+            sequence += uint32_t(buffer.push(batch, size));
+        } else if (buffer.push(Item::make(producer, sequence))) {
+            sequence++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// Yields while the buffer is empty, so the test also progresses on a single core.
+template <typename Buffer>
+static size_t pop(Buffer& buffer, Item* items, size_t max_count) {
+    const auto count = buffer.pop(items, max_count);
+    if (!count) {
+        std::this_thread::yield();
+    }
+    return count;
+}
+
+static void test_spsc() {
+    SpscRingBuffer<Item, 64> buffer;
+
+    std::thread producer([&] { produce(buffer, 0, ITEMS); });
+
+    uint32_t expected = 0;
+    Item items[7];
+    while (expected < ITEMS) {
+        const auto count = pop(buffer, items, 7);
+        for (size_t i = 0; i < count; i++) {
+            CHECK(items[i].is_intact());
+            CHECK(items[i].sequence == expected++);
+        }
+    }
+
+    producer.join();
+    CHECK(buffer.empty());
+}
+
+static void test_spsc_overwrite() {
+    SpscRingBuffer<Item, 64, true> buffer;
+    std::atomic<bool> done{};
+
+    std::thread producer([&] {
+        produce(buffer, 0, ITEMS);
+        done = true;
+    });
+
+    // Items may be dropped, but what's popped is intact and in order. Popping the whole
+    // buffer at once makes it likely the producer overwrites items while they're copied.
+    uint32_t popped = 0;
+    int64_t last = -1;
+    Item items[64];
+    while (true) {
+        const auto finished = done.load();
+        const auto count = pop(buffer, items, 64);
+        for (size_t i = 0; i < count; i++) {
+            CHECK(items[i].is_intact());
+            CHECK(int64_t(items[i].sequence) > last);
+            last = items[i].sequence;
+        }
+        popped += uint32_t(count);
+
+        if (finished && !count) {
+            break;
+        }
+    }
+
+    producer.join();
+    CHECK(last == ITEMS - 1);
+    CHECK(popped + buffer.get_overwritten() == ITEMS);
+}
+
+static void test_mpsc() {
+    static constexpr uint32_t PRODUCERS = 4;
+
+    MpscRingBuffer<Item, 64> buffer;
+
+    std::vector<std::thread> producers;
+    for (uint32_t i = 0; i < PRODUCERS; i++) {
+        producers.emplace_back([&buffer, i] { produce(buffer, i, ITEMS / PRODUCERS); });
+    }
+
+    // Items of different producers interleave, but each producer's are in order.
+    uint32_t expected[PRODUCERS]{};
+    uint32_t popped = 0;
+    Item items[7];
+    while (popped < ITEMS) {
+        const auto count = pop(buffer, items, 7);
+        for (size_t i = 0; i < count; i++) {
+            CHECK(items[i].is_intact());
+            CHECK(items[i].producer < PRODUCERS);
+            CHECK(items[i].sequence == expected[items[i].producer]++);
+        }
+        popped += uint32_t(count);
+    }
+
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    CHECK(buffer.empty());
+}
+
+int main() {
+    test_spsc();
+    test_spsc_overwrite();
+    test_mpsc();
+
+    return 0;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// Minimal stand-in for the ESP-IDF header, just enough for the host tests. The tag is
+// printed so code that logs without declaring one doesn't compile.
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#define ESP_LOGE(tag, format, ...) printf("E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) printf("W %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) printf("I %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ((void)(tag))
+#define ESP_LOGV(tag, format, ...) ((void)(tag))
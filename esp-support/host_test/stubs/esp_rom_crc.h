@@ -0,0 +1,7 @@
+#pragma once
+
+// Minimal stand-in for the ESP-IDF header. Same result as zlib's crc32().
+
+#include <stdint.h>
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len);
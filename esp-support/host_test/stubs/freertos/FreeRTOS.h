@@ -0,0 +1,14 @@
+#pragma once
+
+// Minimal stand-in for the FreeRTOS header, just enough for the host tests.
+
+#include <stdint.h>
+
+typedef int32_t BaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define portMAX_DELAY UINT32_MAX
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
@@ -0,0 +1,45 @@
+#pragma once
+
+// Minimal stand-in for the ESP-IDF header, backed by an in-memory store (see
+// host_nvs.h).
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define ESP_ERR_NVS_BASE 0x1100
+#define ESP_ERR_NVS_NOT_FOUND (ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_NOT_ENOUGH_SPACE (ESP_ERR_NVS_BASE + 0x05)
+#define ESP_ERR_NVS_INVALID_HANDLE (ESP_ERR_NVS_BASE + 0x07)
+#define ESP_ERR_NVS_INVALID_LENGTH (ESP_ERR_NVS_BASE + 0x0c)
+
+#define NVS_KEY_NAME_MAX_SIZE 16
+
+typedef uint32_t nvs_handle_t;
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode_t;
+
+esp_err_t nvs_open(const char* name_space, nvs_open_mode_t open_mode, nvs_handle_t* out_handle);
+void nvs_close(nvs_handle_t handle);
+esp_err_t nvs_commit(nvs_handle_t handle);
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key);
+
+#define NVS_DECLARE_INTEGER(name, type)                                          \
+    esp_err_t nvs_get_##name(nvs_handle_t handle, const char* key, type* value); \
+    esp_err_t nvs_set_##name(nvs_handle_t handle, const char* key, type value);
+
+NVS_DECLARE_INTEGER(i8, int8_t)
+NVS_DECLARE_INTEGER(u8, uint8_t)
+NVS_DECLARE_INTEGER(i16, int16_t)
+NVS_DECLARE_INTEGER(u16, uint16_t)
+NVS_DECLARE_INTEGER(i32, int32_t)
+NVS_DECLARE_INTEGER(u32, uint32_t)
+NVS_DECLARE_INTEGER(i64, int64_t)
+NVS_DECLARE_INTEGER(u64, uint64_t)
+
+#undef NVS_DECLARE_INTEGER
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out_value, size_t* length);
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value);
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length);
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length);
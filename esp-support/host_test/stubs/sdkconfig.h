@@ -0,0 +1,3 @@
+#pragma once
+
+// The host build uses the defaults the headers fall back to when an option isn't set.
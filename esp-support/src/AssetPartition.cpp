@@ -0,0 +1,112 @@
+#include "AssetPartition.h"
+
+#include <cinttypes>
+#include <cstring>
+
+#include "error.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+
+[[maybe_unused]] static const char* TAG = "AssetPartition";
+
+esp_err_t AssetPartition::begin(const char* label, bool verify_crc) {
+    ESP_ASSERT_CHECK(!_header);
+
+    const auto partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (!partition) {
+        ESP_LOGE(TAG, "Cannot find partition %s", label);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Read the header first so only the part of the partition that's in use is mapped.
+    Header header;
+    ESP_ERROR_RETURN(esp_partition_read(partition, 0, &header, sizeof(header)));
+
+    if (header.magic != MAGIC || header.version != VERSION) {
+        ESP_LOGE(TAG, "Partition %s is not an asset partition", label);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (header.size > partition->size - sizeof(header)) {
+        ESP_LOGE(TAG, "Size %" PRIu32 " of partition %s exceeds the partition", header.size, label);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const void* data;
+    ESP_ERROR_RETURN(
+        esp_partition_mmap(partition, 0, sizeof(header) + header.size, ESP_PARTITION_MMAP_DATA, &data, &_mmap_handle));
+
+    _header = (const Header*)data;
+    _entries = (const Entry*)get_payload();
+
+    const auto err = validate(verify_crc);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Partition %s is corrupt", label);
+        end();
+    }
+
+    return err;
+}
+
+esp_err_t AssetPartition::validate(bool verify_crc) {
+    if (verify_crc && esp_rom_crc32_le(0, get_payload(), _header->size) != _header->crc32) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    // Check the index once, so the accessors can trust it.
+    ESP_ASSERT_RETURN(size_t(_header->asset_count) * sizeof(Entry) <= _header->size, ESP_ERR_INVALID_SIZE);
+
+    for (size_t i = 0; i < _header->asset_count; i++) {
+        const auto& entry = _entries[i];
+
+        ESP_ASSERT_RETURN(memchr(entry.name, '\0', sizeof(entry.name)), ESP_ERR_INVALID_STATE);
+        ESP_ASSERT_RETURN(entry.offset <= _header->size && entry.size <= _header->size - entry.offset,
+                          ESP_ERR_INVALID_SIZE);
+    }
+
+    return ESP_OK;
+}
+
+void AssetPartition::end() {
+    if (_header) {
+        esp_partition_munmap(_mmap_handle);
+
+        _header = nullptr;
+        _entries = nullptr;
+    }
+}
+
+ByteView AssetPartition::get_data() const {
+    ESP_ASSERT_CHECK(_header && !_header->asset_count);
+
+    return {get_payload(), _header->size};
+}
+
+std::string_view AssetPartition::get_name(size_t index) const {
+    ESP_ASSERT_CHECK(index < get_count());
+
+    return _entries[index].name;
+}
+
+ByteView AssetPartition::get(size_t index) const {
+    ESP_ASSERT_CHECK(index < get_count());
+
+    const auto& entry = _entries[index];
+
+    return {get_payload() + entry.offset, entry.size};
+}
+
+bool AssetPartition::is_compressed(size_t index) const {
+    ESP_ASSERT_CHECK(index < get_count());
+
+    return _entries[index].flags & FLAG_COMPRESSED;
+}
+
+ByteView AssetPartition::find(std::string_view name) const {
+    for (size_t i = 0; i < get_count(); i++) {
+        if (get_name(i) == name) {
+            return get(i);
+        }
+    }
+
+    return {};
+}
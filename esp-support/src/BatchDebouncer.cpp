@@ -0,0 +1,67 @@
+#include "BatchDebouncer.h"
+
+#include "error.h"
+#include "soc/gpio_reg.h"
+
+[[maybe_unused]] static const char* TAG = "BatchDebouncer";
+
+void BatchDebouncer::add(gpio_num_t pin, bool inverted, gpio_pull_mode_t pull_mode) {
+    ESP_ASSERT_CHECK(pin >= 0 && pin < 32);
+    ESP_ASSERT_CHECK(!_timer.is_valid());
+
+    const gpio_config_t config = {
+        .pin_bit_mask = 1ull << pin,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = pull_mode == GPIO_PULLUP_ONLY ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE,
+        .pull_down_en = pull_mode == GPIO_PULLDOWN_ONLY ? GPIO_PULLDOWN_ENABLE : GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    ESP_ERROR_CHECK(gpio_config(&config));
+
+    const auto mask = 1u << pin;
+
+    _pins |= mask;
+    if (inverted) {
+        _inverted |= mask;
+    }
+}
+
+esp_err_t BatchDebouncer::begin() {
+    _state = sample();
+    _count_low = 0;
+    _count_high = 0;
+    _changed = 0;
+
+    _timer = _queue->enqueue_periodic([this] { update(); }, _tick_ms);
+    if (!_timer.is_valid()) {
+        ESP_LOGE(TAG, "No timer available to sample the pins");
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+void BatchDebouncer::end() {
+    _queue->cancel(_timer);
+    _timer = {};
+}
+
+uint32_t BatchDebouncer::update() {
+    // Inputs that differ from their debounced state count up; the others are reset.
+    const auto delta = sample() ^ _state;
+
+    _count_high = (_count_high ^ _count_low) & delta;
+    _count_low = ~_count_low & delta;
+
+    // The counter wraps to 0 on the fourth consecutive sample that differs.
+    _changed = delta & ~(_count_low | _count_high);
+    _state ^= _changed;
+
+    if (_changed) {
+        _changed_callback.call(_changed);
+    }
+
+    return _changed;
+}
+
+uint32_t BatchDebouncer::sample() const { return (REG_READ(GPIO_IN_REG) ^ _inverted) & _pins; }
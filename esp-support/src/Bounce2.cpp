@@ -2,9 +2,9 @@
 
 #include "Bounce2.h"
 
-#include "esp_timer.h"
+#include "Clock.h"
 
-static uint32_t millis() { return uint32_t(esp_timer_get_time() / 1000ll); }
+static uint32_t millis() { return uint32_t(Clock::now_ms()); }
 
 //////////////
 // DEBOUNCE //
@@ -85,6 +85,23 @@ bool Debouncer::update() {
     return changed();
 }
 
+bool Debouncer::applyState(bool currentState, unsigned long changedAt) {
+    unsetStateFlag(CHANGED_STATE);
+
+    if (currentState != getStateFlag(DEBOUNCED_STATE)) {
+        toggleStateFlag(DEBOUNCED_STATE);
+        setStateFlag(CHANGED_STATE);
+        durationOfPreviousState = changedAt - stateChangeLastTime;
+        stateChangeLastTime = changedAt;
+    }
+
+    if (currentState != getStateFlag(UNSTABLE_STATE)) {
+        toggleStateFlag(UNSTABLE_STATE);
+    }
+
+    return changed();
+}
+
 // WIP HELD
 unsigned long Debouncer::previousDuration() const { return durationOfPreviousState; }
 
@@ -0,0 +1,81 @@
+#include "HeapAccount.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <iterator>
+
+#include "error.h"
+
+[[maybe_unused]] static const char* TAG = "HeapAccount";
+
+#if CONFIG_ESP_SUPPORT_HEAP_ACCOUNTING
+
+static StaticRegistry<HeapAccount> accounts;
+
+void HeapAccount::add_to_registry() { accounts.add(this); }
+
+void* HeapAccount::allocate(size_t size) {
+    const auto block = (uint8_t*)malloc(HEADER_SIZE + size);
+    if (!block) {
+        return nullptr;
+    }
+
+    *(size_t*)block = size;
+    charge(size);
+
+    return block + HEADER_SIZE;
+}
+
+void HeapAccount::deallocate(void* block) {
+    if (!block) {
+        return;
+    }
+
+    const auto start = (uint8_t*)block - HEADER_SIZE;
+
+    release(*(size_t*)start);
+    free(start);
+}
+
+HeapAccountStats HeapAccount::get_stats() const {
+    return {
+        .name = _name,
+        .live_bytes = _live_bytes.load(std::memory_order_relaxed),
+        .peak_bytes = _peak_bytes.load(std::memory_order_relaxed),
+        .allocations = _allocations.load(std::memory_order_relaxed),
+        .frees = _frees.load(std::memory_order_relaxed),
+    };
+}
+
+size_t HeapAccount::get_all_stats(HeapAccountStats* stats, size_t max_count) {
+    size_t count = 0;
+
+    accounts.for_each([&](HeapAccount* account) {
+        if (count < max_count) {
+            stats[count] = account->get_stats();
+        }
+        count++;
+    });
+
+    return count;
+}
+
+#else
+
+HeapAccountStats HeapAccount::get_stats() const { return {}; }
+
+size_t HeapAccount::get_all_stats(HeapAccountStats*, size_t) { return 0; }
+
+#endif
+
+void HeapAccount::log_all_stats() {
+    HeapAccountStats stats[16];
+    const auto count = std::min(get_all_stats(stats, std::size(stats)), std::size(stats));
+
+    for (size_t i = 0; i < count; i++) {
+        const auto& account = stats[i];
+
+        ESP_LOGI(TAG, "%s: %" PRIu32 " bytes live, peak %" PRIu32 ", %" PRIu32 " allocations, %" PRIu32 " frees",
+                 account.name, account.live_bytes, account.peak_bytes, account.allocations, account.frees);
+    }
+}
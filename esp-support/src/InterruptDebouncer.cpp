@@ -0,0 +1,152 @@
+#include "InterruptDebouncer.h"
+
+#include <algorithm>
+
+#include "Clock.h"
+#include "error.h"
+
+[[maybe_unused]] static const char* TAG = "InterruptDebouncer";
+
+bool DebouncedPin::update() {
+    portENTER_CRITICAL(&_owner->_lock);
+    const auto stable = _stable;
+    const auto stable_since_us = _stable_since_us;
+    portEXIT_CRITICAL(&_owner->_lock);
+
+    // Edges are timed with esp_timer in the ISR, but Debouncer measures durations with
+    // Clock. Carry the age of the stable state over, so they also hold with a VirtualClock.
+    const auto age_ms = (esp_timer_get_time() - stable_since_us) / 1000;
+    return applyState(stable, (unsigned long)(Clock::now_ms() - age_ms));
+}
+
+bool DebouncedPin::readCurrentState() { return gpio_get_level(_pin) ^ _inverted; }
+
+DebouncedPin* InterruptDebouncer::add(gpio_num_t pin, bool inverted, gpio_pull_mode_t pull_mode) {
+    ESP_ASSERT_CHECK(_pin_count < CONFIG_ESP_SUPPORT_DEBOUNCER_MAX_PINS);
+    ESP_ASSERT_CHECK(!_timer);
+
+    const gpio_config_t config = {
+        .pin_bit_mask = 1ull << pin,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = pull_mode == GPIO_PULLUP_ONLY ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE,
+        .pull_down_en = pull_mode == GPIO_PULLDOWN_ONLY ? GPIO_PULLDOWN_ENABLE : GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
+    };
+    ESP_ERROR_CHECK(gpio_config(&config));
+
+    auto& result = _pins[_pin_count++];
+    result._owner = this;
+    result._pin = pin;
+    result._inverted = inverted;
+
+    return &result;
+}
+
+esp_err_t InterruptDebouncer::begin() {
+    const esp_timer_create_args_t timer_args = {
+        .callback = [](void* arg) { ((InterruptDebouncer*)arg)->confirm_pending(); },
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "debouncer",
+    };
+    ESP_ERROR_RETURN(esp_timer_create(&timer_args, &_timer));
+
+    // Someone else may have installed the service already.
+    const auto err = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+    if (err != ESP_ERR_INVALID_STATE) {
+        ESP_ERROR_RETURN(err);
+    }
+
+    const auto now = esp_timer_get_time();
+
+    for (size_t i = 0; i < _pin_count; i++) {
+        auto& pin = _pins[i];
+
+        pin.begin();
+        pin._stable = pin.read();
+        pin._stable_since_us = now;
+
+        ESP_ERROR_RETURN(gpio_isr_handler_add(pin._pin, isr_handler, &pin));
+    }
+
+    return ESP_OK;
+}
+
+void IRAM_ATTR InterruptDebouncer::isr_handler(void* arg) {
+    const auto pin = (DebouncedPin*)arg;
+    const auto self = pin->_owner;
+    const auto mask = 1u << (pin - self->_pins);
+
+    const auto now = uint32_t(esp_timer_get_time());
+
+    // The timer task may run on the other core. The first edge is written before the bit is
+    // published, so it never sees the bit with the first edge of an older transition.
+    portENTER_CRITICAL_ISR(&self->_lock);
+    pin->_last_edge_us = now;
+    if (!(self->_pending.load() & mask)) {
+        pin->_first_edge_us = now;
+        self->_pending.fetch_or(mask);
+    }
+    portEXIT_CRITICAL_ISR(&self->_lock);
+
+    if (!self->_timer_armed.exchange(true)) {
+        esp_timer_start_once(self->_timer, self->_interval_us);
+    }
+}
+
+void InterruptDebouncer::confirm_pending() {
+    // Edges from here on arm the timer again.
+    _timer_armed = false;
+
+    const auto now = esp_timer_get_time();
+    auto next_delay_us = UINT32_MAX;
+
+    auto pending = _pending.load();
+    while (pending) {
+        const auto index = __builtin_ctz(pending);
+        const auto mask = 1u << index;
+        pending &= ~mask;
+
+        auto& pin = _pins[index];
+
+        // The pin is only stable once the interval has passed since its last edge. The
+        // edge may be newer than now if it came in after now was sampled.
+        //
+        // Clear the bit before looking at the pin. An edge that comes in after this sets
+        // it again, starts a new transition and arms the timer, so the level sampled
+        // below is never the last one we look at.
+        portENTER_CRITICAL(&_lock);
+        const auto since_last_edge_us = int32_t(uint32_t(now) - pin._last_edge_us.load());
+        const auto settled = since_last_edge_us >= int32_t(_interval_us);
+        if (settled) {
+            _pending.fetch_and(~mask);
+        }
+        const auto first_edge_us = pin._first_edge_us.load();
+        portEXIT_CRITICAL(&_lock);
+
+        if (!settled) {
+            next_delay_us = std::min(next_delay_us, uint32_t(int32_t(_interval_us) - std::max(since_last_edge_us, 0)));
+            continue;
+        }
+
+        const auto level = pin.readCurrentState();
+        const auto time_us = now - int64_t(uint32_t(now) - first_edge_us);
+
+        portENTER_CRITICAL(&_lock);
+        // Bouncing back to the stable level doesn't count as a change.
+        const auto changed = level != pin._stable;
+        if (changed) {
+            pin._stable = level;
+            pin._stable_since_us = time_us;
+        }
+        portEXIT_CRITICAL(&_lock);
+
+        if (changed) {
+            _edge.queue(_queue, {pin._pin, level, time_us});
+        }
+    }
+
+    if (next_delay_us != UINT32_MAX && !_timer_armed.exchange(true)) {
+        ESP_ERROR_CHECK(esp_timer_start_once(_timer, next_delay_us));
+    }
+}
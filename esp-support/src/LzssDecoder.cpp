@@ -0,0 +1,69 @@
+#include "LzssDecoder.h"
+
+#include "error.h"
+#include "esp_log.h"
+
+[[maybe_unused]] static const char* TAG = "LzssDecoder";
+
+LzssDecoder::LzssDecoder(ByteView input) {
+    if (input.size() < sizeof(uint32_t)) {
+        return;
+    }
+
+    _size = uint32_t(input[0] | input[1] << 8 | input[2] << 16 | input[3] << 24);
+    _remaining = _size;
+    _input = input.subspan(sizeof(uint32_t));
+}
+
+esp_err_t LzssDecoder::read(ByteSpan buffer, size_t& length) {
+    // Raw pointers; the loop below checks the bounds itself.
+    const auto input = _input.data();
+    const auto output = buffer.data();
+
+    length = 0;
+
+    while (length < buffer.size() && _remaining) {
+        if (_match_remaining) {
+            _match_remaining--;
+            emit(_window[(_window_pos - _match_distance) & WINDOW_MASK], output, length);
+            continue;
+        }
+
+        if (!_flag_bits) {
+            ESP_ASSERT_RETURN(_input_pos < _input.size(), ESP_ERR_INVALID_STATE);
+
+            _flags = input[_input_pos++];
+            _flag_bits = 8;
+        }
+
+        const auto literal = _flags & 1;
+        _flags >>= 1;
+        _flag_bits--;
+
+        if (literal) {
+            ESP_ASSERT_RETURN(_input_pos < _input.size(), ESP_ERR_INVALID_STATE);
+
+            emit(input[_input_pos++], output, length);
+        } else {
+            ESP_ASSERT_RETURN(_input_pos + 2 <= _input.size(), ESP_ERR_INVALID_STATE);
+
+            const auto token = uint16_t(input[_input_pos] | input[_input_pos + 1] << 8);
+            _input_pos += 2;
+
+            _match_distance = uint16_t((token >> LENGTH_BITS) + 1);
+            _match_remaining = uint16_t((token & ((1 << LENGTH_BITS) - 1)) + MIN_MATCH);
+
+            // References can't reach before the start of the output or past its end.
+            ESP_ASSERT_RETURN(_match_distance <= _size - _remaining, ESP_ERR_INVALID_STATE);
+            ESP_ASSERT_RETURN(_match_remaining <= _remaining, ESP_ERR_INVALID_STATE);
+        }
+    }
+
+    return ESP_OK;
+}
+
+void LzssDecoder::emit(uint8_t value, uint8_t* output, size_t& length) {
+    output[length++] = value;
+    _window[_window_pos++ & WINDOW_MASK] = value;
+    _remaining--;
+}
@@ -0,0 +1,133 @@
+#include "MemoryPool.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <iterator>
+
+#include "error.h"
+
+[[maybe_unused]] static const char* TAG = "MemoryPool";
+
+static MemoryPool* pools;
+#ifdef LV_SIMULATOR
+static std::mutex pools_lock;
+#define POOLS_LOCK() pools_lock.lock()
+#define POOLS_UNLOCK() pools_lock.unlock()
+#else
+static portMUX_TYPE pools_lock = portMUX_INITIALIZER_UNLOCKED;
+#define POOLS_LOCK() portENTER_CRITICAL(&pools_lock)
+#define POOLS_UNLOCK() portEXIT_CRITICAL(&pools_lock)
+#endif
+
+MemoryPool::MemoryPool(const char* name, size_t block_size, size_t capacity)
+    : _name(name), _capacity(capacity) {
+    // Round up so every block can hold the free list link and stays aligned.
+    constexpr auto ALIGNMENT = alignof(std::max_align_t);
+    block_size = std::max(block_size, sizeof(FreeBlock));
+    _block_size = (block_size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+    _blocks = new uint8_t[_block_size * _capacity];
+    ESP_ASSERT_CHECK(_blocks);
+
+    // Thread the free list through the blocks in address order.
+    for (auto i = _capacity; i > 0; i--) {
+        const auto block = (FreeBlock*)(_blocks + (i - 1) * _block_size);
+        block->next = _free;
+        _free = block;
+    }
+
+    POOLS_LOCK();
+    _next_pool = pools;
+    pools = this;
+    POOLS_UNLOCK();
+}
+
+MemoryPool::~MemoryPool() {
+    POOLS_LOCK();
+    for (auto link = &pools; *link; link = &(*link)->_next_pool) {
+        if (*link == this) {
+            *link = _next_pool;
+            break;
+        }
+    }
+    POOLS_UNLOCK();
+
+    delete[] _blocks;
+}
+
+void* MemoryPool::allocate() {
+    lock();
+
+    const auto block = _free;
+    if (block) {
+        _free = block->next;
+        if (++_in_use > _peak) {
+            _peak = _in_use;
+        }
+    } else {
+        _failures++;
+    }
+
+    unlock();
+
+    return block;
+}
+
+void MemoryPool::deallocate(void* block) {
+    ESP_ASSERT_CHECK(owns(block));
+
+    lock();
+
+    const auto free_block = (FreeBlock*)block;
+    free_block->next = _free;
+    _free = free_block;
+    _in_use--;
+
+    unlock();
+}
+
+MemoryPoolStats MemoryPool::get_stats() {
+    lock();
+
+    const MemoryPoolStats stats = {
+        .name = _name,
+        .block_size = uint32_t(_block_size),
+        .capacity = uint32_t(_capacity),
+        .in_use = _in_use,
+        .peak = _peak,
+        .failures = _failures,
+    };
+
+    unlock();
+
+    return stats;
+}
+
+size_t MemoryPool::get_all_stats(MemoryPoolStats* stats, size_t max_count) {
+    size_t count = 0;
+
+    // The pool locks are only ever taken inside the registry lock, never the other way around.
+    POOLS_LOCK();
+    for (auto pool = pools; pool; pool = pool->_next_pool) {
+        if (count < max_count) {
+            stats[count] = pool->get_stats();
+        }
+        count++;
+    }
+    POOLS_UNLOCK();
+
+    return count;
+}
+
+void MemoryPool::log_all_stats() {
+    MemoryPoolStats stats[16];
+    const auto count = std::min(get_all_stats(stats, std::size(stats)), std::size(stats));
+
+    for (size_t i = 0; i < count; i++) {
+        const auto& pool = stats[i];
+
+        ESP_LOGI(TAG, "%s: %" PRIu32 " of %" PRIu32 " blocks of %" PRIu32 " bytes in use, peak %" PRIu32
+                 ", failures %" PRIu32,
+                 pool.name, pool.in_use, pool.capacity, pool.block_size, pool.peak, pool.failures);
+    }
+}
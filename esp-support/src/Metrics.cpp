@@ -0,0 +1,40 @@
+#include "Metrics.h"
+
+static StaticRegistry<Metric> metrics;
+
+void Metric::add_to_registry() { metrics.add(this); }
+
+void Metric::add_all_to_json(cJSON* parent) {
+    metrics.for_each([parent](Metric* metric) { metric->add_to_json(parent); });
+}
+
+void MetricCounter::add_to_json(cJSON* parent) const { cJSON_AddNumberToObject(parent, get_name(), get()); }
+
+void MetricGauge::add_to_json(cJSON* parent) const { cJSON_AddNumberToObject(parent, get_name(), get()); }
+
+void MetricHistogramBase::record(uint32_t value) {
+    ensure_added();
+
+    const auto bucket = std::lower_bound(_bounds, _bounds + _bound_count, value) - _bounds;
+    _counts[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    auto max = _max.load(std::memory_order_relaxed);
+    while (value > max && !_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+void MetricHistogramBase::add_to_json(cJSON* parent) const {
+    auto item = cJSON_AddObjectToObject(parent, get_name());
+
+    auto bounds = cJSON_AddArrayToObject(item, "bounds");
+    for (size_t i = 0; i < _bound_count; i++) {
+        cJSON_AddItemToArray(bounds, cJSON_CreateNumber(_bounds[i]));
+    }
+
+    auto counts = cJSON_AddArrayToObject(item, "counts");
+    for (size_t i = 0; i <= _bound_count; i++) {
+        cJSON_AddItemToArray(counts, cJSON_CreateNumber(_counts[i].load(std::memory_order_relaxed)));
+    }
+
+    cJSON_AddNumberToObject(item, "max", get_max());
+}
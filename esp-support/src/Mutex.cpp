@@ -2,6 +2,12 @@
 
 #include "error.h"
 
+#if CONFIG_ESP_SUPPORT_MUTEX_STATS
+#include <algorithm>
+
+#include "esp_timer.h"
+#endif
+
 MutexLock::MutexLock(Mutex* mutex) : _mutex(mutex) {}
 
 MutexLock::~MutexLock() { _mutex->give(); }
@@ -15,9 +21,49 @@ Mutex::Mutex() {
 Mutex::~Mutex() { vSemaphoreDelete(_lock); }
 
 MutexLock Mutex::take(TickType_t xTicksToWait) {
-    ESP_ASSERT_CHECK(xSemaphoreTake(_lock, xTicksToWait));
+    ESP_ASSERT_CHECK(try_take(xTicksToWait));
 
     return {this};
 }
 
+bool Mutex::try_take(TickType_t xTicksToWait) {
+#if CONFIG_ESP_SUPPORT_MUTEX_STATS
+    if (xSemaphoreTake(_lock, 0) == pdTRUE) {
+        _stats.acquired++;
+        return true;
+    }
+
+    if (!xTicksToWait) {
+        return false;
+    }
+
+    const auto holder = xSemaphoreGetMutexHolder(_lock);
+    const auto start = esp_timer_get_time();
+
+    if (xSemaphoreTake(_lock, xTicksToWait) != pdTRUE) {
+        return false;
+    }
+
+    const auto wait = uint32_t(std::min(esp_timer_get_time() - start, int64_t(UINT32_MAX)));
+
+    _stats.acquired++;
+    _stats.contended++;
+    _stats.wait_total_us += wait;
+    _stats.wait_max_us = std::max(_stats.wait_max_us, wait);
+    _stats.last_holder = holder;
+
+    return true;
+#else
+    return xSemaphoreTake(_lock, xTicksToWait) == pdTRUE;
+#endif
+}
+
 void Mutex::give() { xSemaphoreGive(_lock); }
+
+#if CONFIG_ESP_SUPPORT_MUTEX_STATS
+
+MutexStats Mutex::get_stats() {
+    return with([this] { return _stats; });
+}
+
+#endif
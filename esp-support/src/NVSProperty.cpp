@@ -30,25 +30,58 @@ esp_err_t nvs_set_f32(nvs_handle_t handle, const char* key, float value) {
     return nvs_set_u32(handle, key, raw_value);
 }
 
-#define NVSProperty_DEFINE(type, typename_uc, typename_lc)                        \
-    type NVSProperty##typename_uc::get(nvs_handle_t handle, type default_value) { \
-        type value;                                                               \
-        const auto err = nvs_get_##typename_lc(handle, get_key(), &value);        \
-        if (err != ESP_OK) {                                                      \
-            value = default_value;                                                \
-        }                                                                         \
-        return value;                                                             \
-    }                                                                             \
-                                                                                  \
-    void NVSProperty##typename_uc::set(nvs_handle_t handle, type value) {         \
-        ESP_ERROR_CHECK(nvs_set_##typename_lc(handle, get_key(), value));         \
+esp_err_t nvs_get_value(nvs_handle_t handle, const char* key, std::string& value) {
+    // Try the capacity the string already has first. When it's too small, NVS tells us
+    // the length it needs.
+    value.resize(value.capacity());
+    auto length = value.size() + 1;
+
+    auto err = nvs_get_str(handle, key, value.data(), &length);
+    if (err == ESP_ERR_NVS_INVALID_LENGTH) {
+        value.resize(length - 1);
+        err = nvs_get_str(handle, key, value.data(), &length);
+    }
+    if (err != ESP_OK) {
+        value.clear();
+        return err;
+    }
+
+    value.resize(length - 1);
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_value(nvs_handle_t handle, const char* key, const std::string& value) {
+    return nvs_set_str(handle, key, value.c_str());
+}
+
+esp_err_t nvs_get_value(nvs_handle_t handle, const char* key, NVSBlob& value) {
+    size_t length;
+    if (value.capacity()) {
+        value.resize(value.capacity());
+        length = value.size();
+    } else {
+        const auto err = nvs_get_blob(handle, key, nullptr, &length);
+        if (err != ESP_OK) {
+            value.clear();
+            return err;
+        }
+        value.resize(length);
+    }
+
+    auto err = nvs_get_blob(handle, key, value.data(), &length);
+    if (err == ESP_ERR_NVS_INVALID_LENGTH) {
+        value.resize(length);
+        err = nvs_get_blob(handle, key, value.data(), &length);
+    }
+    if (err != ESP_OK) {
+        value.clear();
+        return err;
     }
 
-NVSProperty_DEFINE(bool, I1, i1);
-NVSProperty_DEFINE(int8_t, I8, i8);
-NVSProperty_DEFINE(uint8_t, U8, u8);
-NVSProperty_DEFINE(int16_t, I16, i16);
-NVSProperty_DEFINE(uint16_t, U16, u16);
-NVSProperty_DEFINE(int32_t, I32, i32);
-NVSProperty_DEFINE(uint32_t, U32, u32);
-NVSProperty_DEFINE(float, F32, f32);
+    value.resize(length);
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_value(nvs_handle_t handle, const char* key, const NVSBlob& value) {
+    return nvs_set_blob(handle, key, value.data(), value.size());
+}
@@ -0,0 +1,126 @@
+#include "NVSStore.h"
+
+#include "error.h"
+
+[[maybe_unused]] static const char* TAG = "NVSStore";
+
+NVSCachedPropertyBase::NVSCachedPropertyBase(NVSStore* store) : _store(store), _next(nullptr) { store->add(this); }
+
+void NVSCachedPropertyBase::mark_dirty() {
+    if (!_dirty.exchange(true)) {
+        _store->schedule_flush();
+    }
+}
+
+esp_err_t NVSStore::load() {
+    nvs_handle_t handle;
+    auto err = nvs_open(_namespace, NVS_READONLY, &handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        // Nothing was ever written to the namespace.
+        return ESP_OK;
+    }
+    ESP_ERROR_RETURN(err);
+
+    for (auto property = _properties; property; property = property->_next) {
+        property->load(handle);
+    }
+
+    nvs_close(handle);
+
+    return ESP_OK;
+}
+
+esp_err_t NVSStore::flush() {
+    // Changes made after this get a new flush.
+    _flush_scheduled = false;
+
+    return _flush_mutex.with([this]() -> esp_err_t {
+        if (!is_dirty()) {
+            return ESP_OK;
+        }
+
+        nvs_handle_t handle;
+        auto err = nvs_open(_namespace, NVS_READWRITE, &handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to open namespace %s: %s", _namespace, esp_err_to_name(err));
+
+            // Nothing was written, so all properties are still dirty.
+            schedule_flush();
+            return err;
+        }
+
+        auto written = false;
+        for (auto property = _properties; property; property = property->_next) {
+            // Clear the flag before reading the value. A change made while we write
+            // marks the property dirty again.
+            if (!property->_dirty.exchange(false)) {
+                continue;
+            }
+
+            const auto store_err = property->store(handle);
+            if (store_err == ESP_OK) {
+                property->_uncommitted = true;
+                written = true;
+            } else {
+                ESP_LOGE(TAG, "Failed to write %s in namespace %s: %s", property->get_key(), _namespace,
+                         esp_err_to_name(store_err));
+
+                property->_dirty = true;
+                err = store_err;
+            }
+        }
+
+        const auto commit_err = written ? nvs_commit(handle) : ESP_OK;
+
+        nvs_close(handle);
+
+        if (commit_err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to commit namespace %s: %s", _namespace, esp_err_to_name(commit_err));
+            err = commit_err;
+        }
+
+        for (auto property = _properties; property; property = property->_next) {
+            if (property->_uncommitted) {
+                property->_uncommitted = false;
+                // What was written may not have reached flash.
+                if (commit_err != ESP_OK) {
+                    property->_dirty = true;
+                }
+            }
+        }
+
+        if (err != ESP_OK) {
+            schedule_flush();
+        }
+
+        return err;
+    });
+}
+
+bool NVSStore::is_dirty() const {
+    for (auto property = _properties; property; property = property->_next) {
+        if (property->is_dirty()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void NVSStore::add(NVSCachedPropertyBase* property) {
+    property->_next = _properties;
+    _properties = property;
+}
+
+void NVSStore::schedule_flush() {
+    if (!_queue || _flush_scheduled.exchange(true)) {
+        return;
+    }
+
+    const auto handle = _queue->enqueue_delayed([this] { flush(); }, _commit_delay_ms);
+    if (!handle.is_valid()) {
+        ESP_LOGW(TAG, "No timer available; flushing namespace %s immediately", _namespace);
+
+        _queue->enqueue([this] { flush(); }, QueuePriority::Bulk);
+    }
+}
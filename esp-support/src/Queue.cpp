@@ -1,75 +1,629 @@
 #include "Queue.h"
 
+#include "Clock.h"
 #include "error.h"
 
+[[maybe_unused]] static const char* TAG = "Queue";
+
 #ifndef LV_SIMULATOR
 
 #include <algorithm>
+#include <cinttypes>
 
+#include "HeapAccount.h"
+#include "Metrics.h"
 #include "esp_timer.h"
 
+// Combined over all queues and lanes; the per lane numbers are in Queue::get_stats().
+static constexpr uint32_t TIME_BOUNDS_US[] = {100, 1000, 10000, 100000, 1000000};
+static MetricHistogram latency_metric("queue.latency_us", TIME_BOUNDS_US);
+#if CONFIG_ESP_SUPPORT_QUEUE_INSTRUMENTATION
+static MetricHistogram run_time_metric("queue.run_time_us", TIME_BOUNDS_US);
+#endif
+
+// Closures too large to store inline while they're queued, and slots that didn't fit
+// in the pool.
+static HeapAccount heap_account("queue");
+
+#if CONFIG_ESP_SUPPORT_QUEUE_INSTRUMENTATION
+
+static void record_histogram(std::atomic<uint32_t> (&histogram)[QUEUE_HISTOGRAM_BUCKETS], uint32_t value_us) {
+    size_t bucket = 0;
+    if (value_us >= QUEUE_HISTOGRAM_FIRST_BUCKET_US) {
+        // Number of times the first bucket bound needs to double to exceed the value.
+        bucket = size_t(__builtin_clz(QUEUE_HISTOGRAM_FIRST_BUCKET_US) - __builtin_clz(value_us)) + 1;
+        bucket = std::min(bucket, QUEUE_HISTOGRAM_BUCKETS - 1);
+    }
+
+    histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+#endif
+
+static void update_max(std::atomic<uint32_t>& max, uint32_t value) {
+    auto current = max.load(std::memory_order_relaxed);
+    while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
 Queue::Queue() {
-    _queue = xQueueCreate(32, sizeof(void*));
+    for (auto& lane : _lanes) {
+        lane.queue = xQueueCreate(CONFIG_ESP_SUPPORT_QUEUE_LENGTH, sizeof(Slot*));
 
-    ESP_ASSERT_CHECK(_queue);
+        ESP_ASSERT_CHECK(lane.queue);
+    }
+
+    for (auto& slot : _slots) {
+        slot.next = _free_slots;
+        _free_slots = &slot;
+    }
+}
+
+void Queue::enqueue(Task task, bool wait) {
+    enqueue_from(std::move(task), QueuePriority::Interactive, wait, __builtin_return_address(0));
 }
 
-void Queue::enqueue(const std::function<void()>& task, bool wait) {
-    auto* copy = new std::function<void()>(task);
+void Queue::enqueue(Task task, QueuePriority priority, bool wait) {
+    enqueue_from(std::move(task), priority, wait, __builtin_return_address(0));
+}
+
+void Queue::enqueue_from(Task task, QueuePriority priority, bool wait, void* caller) {
+    if (!task.is_inline()) {
+        _oversized.fetch_add(1, std::memory_order_relaxed);
+        heap_account.charge(task.get_heap_size());
+    }
+
+    auto slot = acquire_slot();
+    slot->task = std::move(task);
+    slot->enqueued_at = esp_timer_get_time();
+#if CONFIG_ESP_SUPPORT_QUEUE_INSTRUMENTATION
+    slot->caller = caller;
+#endif
+
+    auto& lane = _lanes[int(priority)];
+
+    ESP_ASSERT_CHECK(xQueueSend(lane.queue, &slot, wait ? portMAX_DELAY : 0));
+
+    notify();
+
+    update_max(lane.depth_peak, uint32_t(uxQueueMessagesWaiting(lane.queue)));
+}
 
-    ESP_ASSERT_CHECK(xQueueSend(_queue, &copy, wait ? portMAX_DELAY : 0));
+TimerHandle Queue::enqueue_delayed(Task task, uint32_t delay_ms) {
+    return schedule(std::move(task), delay_ms, 0, __builtin_return_address(0));
 }
 
-void Queue::enqueue_delayed(const std::function<void()>& task, uint32_t delay_ms) {
-    auto execute_at = esp_timer_get_time() + delay_ms * 1000;
+TimerHandle Queue::enqueue_periodic(Task task, uint32_t interval_ms) {
+    ESP_ASSERT_CHECK(interval_ms > 0);
 
-    portENTER_CRITICAL(&_delayed_tasks_lock);
+    return schedule(std::move(task), interval_ms, interval_ms, __builtin_return_address(0));
+}
+
+bool Queue::cancel(TimerHandle handle) {
+    void* payload;
+    const auto pending = _timers.cancel(handle, payload);
 
-    auto it = std::lower_bound(_delayed_tasks.begin(), _delayed_tasks.end(), execute_at,
-                               [](const auto& entry, int64_t time) { return entry.first < time; });
-    _delayed_tasks.insert(it, {execute_at, task});
+    if (payload) {
+        release_slot((Slot*)payload);
+    }
 
-    portEXIT_CRITICAL(&_delayed_tasks_lock);
+    return pending;
 }
 
 void Queue::process() {
     handled_delayed_enqueues();
 
-    while (uxQueueMessagesWaiting(_queue) > 0) {
-        std::function<void()>* task;
-        if (xQueueReceive(_queue, &task, 0) == pdTRUE) {
-            (*task)();
-            delete task;
+    // Bulk tasks run one at a time so interactive work that comes in while
+    // they run gets to go first.
+    do {
+        while (run_next(QueuePriority::Interactive)) {
         }
+    } while (run_next(QueuePriority::Bulk));
+}
+
+void Queue::wait_and_process(uint32_t max_wait_ms) {
+    _process_task = xTaskGetCurrentTaskHandle();
+
+    const auto now = Clock::now_us();
+
+    auto deadline = std::min(_timers.next_deadline(), _wake_at.exchange(INT64_MAX));
+    if (max_wait_ms != UINT32_MAX) {
+        deadline = std::min(deadline, now + int64_t(max_wait_ms) * 1000);
+    }
+
+    // Tasks enqueued from the processing task don't signal, so check for those
+    // before blocking.
+    if (deadline > now && !has_pending()) {
+        auto ticks = portMAX_DELAY;
+        if (deadline != INT64_MAX) {
+            constexpr int64_t tick_us = portTICK_PERIOD_MS * 1000;
+
+            // Round up so we don't wake before the deadline.
+            ticks = TickType_t(std::min((deadline - now + tick_us - 1) / tick_us, int64_t(portMAX_DELAY - 1)));
+        }
+
+        _wake.wait(ticks);
+    }
+
+    process();
+}
+
+void Queue::wake_after(uint32_t delay_ms) {
+    if (delay_ms == UINT32_MAX) {
+        return;
+    }
+
+    const auto wake_at = Clock::now_us() + int64_t(delay_ms) * 1000;
+
+    auto current = _wake_at.load(std::memory_order_relaxed);
+    while (wake_at < current && !_wake_at.compare_exchange_weak(current, wake_at, std::memory_order_relaxed)) {
+    }
+
+    if (wake_at < current) {
+        notify();
+    }
+}
+
+bool Queue::has_pending() {
+    for (auto& lane : _lanes) {
+        if (uxQueueMessagesWaiting(lane.queue)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Queue::notify() {
+    // The processing task drains the queue and recomputes its deadline before it
+    // blocks again, so it never needs to wake itself.
+    if (xTaskGetCurrentTaskHandle() != _process_task.load(std::memory_order_relaxed)) {
+        _wake.signal();
     }
 }
 
+bool Queue::run_next(QueuePriority priority) {
+    auto& lane = _lanes[int(priority)];
+
+    Slot* slot;
+    if (xQueueReceive(lane.queue, &slot, 0) != pdTRUE) {
+        return false;
+    }
+
+    const auto latency = uint32_t(std::min(esp_timer_get_time() - slot->enqueued_at, int64_t(UINT32_MAX)));
+
+    lane.processed.fetch_add(1, std::memory_order_relaxed);
+    lane.latency_total_us.fetch_add(latency, std::memory_order_relaxed);
+    update_max(lane.latency_max_us, latency);
+    latency_metric.record(latency);
+#if CONFIG_ESP_SUPPORT_QUEUE_INSTRUMENTATION
+    record_histogram(lane.latency_histogram, latency);
+#endif
+
+    execute(lane, slot);
+    release_slot(slot);
+
+    return true;
+}
+
+void Queue::execute(Lane& lane, Slot* slot) {
+#if CONFIG_ESP_SUPPORT_QUEUE_INSTRUMENTATION
+    if (!slot->caller) {
+        slot->task();
+        return;
+    }
+
+    const auto start = esp_timer_get_time();
+
+    slot->task();
+
+    const auto run_time = uint32_t(std::min(esp_timer_get_time() - start, int64_t(UINT32_MAX)));
+
+    lane.run_time_count.fetch_add(1, std::memory_order_relaxed);
+    lane.run_time_total_us.fetch_add(run_time, std::memory_order_relaxed);
+    update_max(lane.run_time_max_us, run_time);
+    record_histogram(lane.run_time_histogram, run_time);
+    run_time_metric.record(run_time);
+
+    if (run_time >= CONFIG_ESP_SUPPORT_QUEUE_SLOW_TASK_THRESHOLD_MS * 1000) {
+        lane.slow_tasks.fetch_add(1, std::memory_order_relaxed);
+        _last_slow_task_caller = slot->caller;
+        _last_slow_task_run_time_us = run_time;
+
+        ESP_LOGW(TAG, "Task enqueued from %p ran for %" PRIu32 " ms", slot->caller, run_time / 1000);
+    }
+#else
+    slot->task();
+#endif
+}
+
 void Queue::handled_delayed_enqueues() {
-    auto now = esp_timer_get_time();
+    auto now = Clock::now_us();
+
+    // Timers only hand out a handle. The task itself stays in its slot until the
+    // trampoline runs, so periodic timers can be rescheduled and cancelled timers
+    // are skipped even after they've been queued.
+    TimerHandle handle;
+    while (_timers.pop_due(now, handle)) {
+        enqueue_from([this, handle] { run_timer(handle); }, QueuePriority::Interactive, false /* wait */,
+                     nullptr /* caller */);
+    }
+}
 
-    portENTER_CRITICAL(&_delayed_tasks_lock);
+TimerHandle Queue::schedule(Task task, uint32_t delay_ms, uint32_t period_ms, void* caller) {
+    if (!task.is_inline()) {
+        _oversized.fetch_add(1, std::memory_order_relaxed);
+        heap_account.charge(task.get_heap_size());
+    }
 
-    while (!_delayed_tasks.empty() && _delayed_tasks.front().first <= now) {
-        auto task = _delayed_tasks.front().second;
-        _delayed_tasks.erase(_delayed_tasks.begin());
+    // Move the task into its slot before taking the timer lock.
+    auto slot = acquire_slot();
+    slot->task = std::move(task);
+#if CONFIG_ESP_SUPPORT_QUEUE_INSTRUMENTATION
+    slot->caller = caller;
+#endif
 
-        enqueue(task, false /* wait */);
+    const auto handle = _timers.schedule(slot, Clock::now_us() + int64_t(delay_ms) * 1000, int64_t(period_ms) * 1000);
+    if (!handle.is_valid()) {
+        ESP_LOGW(TAG, "All %d timers are in use", CONFIG_ESP_SUPPORT_QUEUE_MAX_TIMERS);
+
+        release_slot(slot);
+        return {};
     }
 
-    portEXIT_CRITICAL(&_delayed_tasks_lock);
+    // The new timer may be due before the processing task would wake up.
+    notify();
+
+    return handle;
+}
+
+void Queue::run_timer(TimerHandle handle) {
+    bool cancelled;
+    auto slot = (Slot*)_timers.acquire(handle, cancelled);
+    if (!slot) {
+        return;
+    }
+
+    if (!cancelled) {
+        // Timer trampolines run in the interactive lane.
+        execute(_lanes[int(QueuePriority::Interactive)], slot);
+
+        if (!_timers.complete(handle, Clock::now_us())) {
+            return;
+        }
+    }
+
+    release_slot(slot);
+}
+
+QueueStats Queue::get_stats() {
+    QueueStats stats = {
+        .pool_size = CONFIG_ESP_SUPPORT_QUEUE_POOL_SIZE,
+    };
+
+    for (size_t i = 0; i < QUEUE_PRIORITY_COUNT; i++) {
+        auto& lane = _lanes[i];
+        auto& lane_stats = stats.lanes[i];
+
+        lane_stats.depth = uint32_t(uxQueueMessagesWaiting(lane.queue));
+        lane_stats.depth_peak = lane.depth_peak.load(std::memory_order_relaxed);
+        lane_stats.processed = lane.processed.load(std::memory_order_relaxed);
+        lane_stats.latency_max_us = lane.latency_max_us.load(std::memory_order_relaxed);
+        if (lane_stats.processed) {
+            lane_stats.latency_avg_us =
+                uint32_t(lane.latency_total_us.load(std::memory_order_relaxed) / lane_stats.processed);
+        }
+
+#if CONFIG_ESP_SUPPORT_QUEUE_INSTRUMENTATION
+        for (size_t j = 0; j < QUEUE_HISTOGRAM_BUCKETS; j++) {
+            lane_stats.latency_histogram[j] = lane.latency_histogram[j].load(std::memory_order_relaxed);
+            lane_stats.run_time_histogram[j] = lane.run_time_histogram[j].load(std::memory_order_relaxed);
+        }
+
+        lane_stats.run_time_max_us = lane.run_time_max_us.load(std::memory_order_relaxed);
+        const auto run_time_count = lane.run_time_count.load(std::memory_order_relaxed);
+        if (run_time_count) {
+            lane_stats.run_time_avg_us =
+                uint32_t(lane.run_time_total_us.load(std::memory_order_relaxed) / run_time_count);
+        }
+        lane_stats.slow_tasks = lane.slow_tasks.load(std::memory_order_relaxed);
+#endif
+    }
+
+    portENTER_CRITICAL(&_slots_lock);
+
+    stats.pool_in_use = _slots_in_use;
+    stats.pool_peak = _slots_peak;
+
+    portEXIT_CRITICAL(&_slots_lock);
+
+    stats.pool_exhausted = _pool_exhausted.load(std::memory_order_relaxed);
+    stats.oversized = _oversized.load(std::memory_order_relaxed);
+#if CONFIG_ESP_SUPPORT_QUEUE_INSTRUMENTATION
+    stats.last_slow_task_caller = _last_slow_task_caller.load(std::memory_order_relaxed);
+    stats.last_slow_task_run_time_us = _last_slow_task_run_time_us.load(std::memory_order_relaxed);
+#endif
+
+    return stats;
+}
+
+Queue::Slot* Queue::acquire_slot() {
+    portENTER_CRITICAL(&_slots_lock);
+
+    auto slot = _free_slots;
+    if (slot) {
+        _free_slots = slot->next;
+        _slots_in_use++;
+        _slots_peak = std::max(_slots_peak, _slots_in_use);
+    }
+
+    portEXIT_CRITICAL(&_slots_lock);
+
+    if (!slot) {
+        // The pool is sized to cover the FreeRTOS queues of both lanes plus all timers,
+        // so this should be rare. Fall back to the heap rather than failing.
+        _pool_exhausted.fetch_add(1, std::memory_order_relaxed);
+
+        slot = heap_account.create<Slot>();
+    }
+
+    return slot;
+}
+
+void Queue::release_slot(Slot* slot) {
+    // Destroy captures outside of the critical section.
+    if (const auto heap_size = slot->task.get_heap_size()) {
+        heap_account.release(heap_size);
+    }
+    slot->task = nullptr;
+
+    if (slot < std::begin(_slots) || slot >= std::end(_slots)) {
+        heap_account.destroy(slot);
+        return;
+    }
+
+    portENTER_CRITICAL(&_slots_lock);
+
+    slot->next = _free_slots;
+    _free_slots = slot;
+    _slots_in_use--;
+
+    portEXIT_CRITICAL(&_slots_lock);
 }
 
 #else
 
+#include <algorithm>
+#include <chrono>
+
+// Host implementation for the simulator. It has the same semantics as the FreeRTOS
+// implementation, but doesn't pool slots or collect instrumentation.
+
 Queue::Queue() {}
 
-void Queue::enqueue(const std::function<void()>& task, bool wait) { _queue.push_back(task); }
+void Queue::enqueue(Task task, bool wait) { enqueue(std::move(task), QueuePriority::Interactive, wait); }
+
+void Queue::enqueue(Task task, QueuePriority priority, bool wait) {
+    if (!task.is_inline()) {
+        _oversized.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    {
+        std::unique_lock lock(_mutex);
+
+        auto& lane = _lanes[int(priority)];
+
+        if (lane.entries.size() >= CONFIG_ESP_SUPPORT_QUEUE_LENGTH) {
+            ESP_ASSERT_CHECK(wait);
+
+            _not_full.wait(lock, [&lane] { return lane.entries.size() < CONFIG_ESP_SUPPORT_QUEUE_LENGTH; });
+        }
+
+        lane.entries.push_back({std::move(task), Clock::get_system_time_us()});
+        lane.depth_peak = std::max(lane.depth_peak, uint32_t(lane.entries.size()));
+    }
+
+    notify();
+}
+
+TimerHandle Queue::enqueue_delayed(Task task, uint32_t delay_ms) {
+    return schedule(std::move(task), delay_ms, 0, nullptr);
+}
+
+TimerHandle Queue::enqueue_periodic(Task task, uint32_t interval_ms) {
+    ESP_ASSERT_CHECK(interval_ms > 0);
+
+    return schedule(std::move(task), interval_ms, interval_ms, nullptr);
+}
+
+bool Queue::cancel(TimerHandle handle) {
+    void* payload;
+    const auto pending = _timers.cancel(handle, payload);
+
+    delete (Task*)payload;
+
+    return pending;
+}
 
 void Queue::process() {
-    while (!_queue.empty()) {
-        _queue.front()();
-        _queue.pop_front();
+    handled_delayed_enqueues();
+
+    do {
+        while (run_next(QueuePriority::Interactive)) {
+        }
+    } while (run_next(QueuePriority::Bulk));
+}
+
+void Queue::wait_and_process(uint32_t max_wait_ms) {
+    {
+        std::unique_lock lock(_mutex);
+
+        _process_thread = std::this_thread::get_id();
+
+        const auto now = Clock::now_us();
+
+        auto deadline = std::min(_timers.next_deadline(), std::exchange(_wake_at, INT64_MAX));
+        if (max_wait_ms != UINT32_MAX) {
+            deadline = std::min(deadline, now + int64_t(max_wait_ms) * 1000);
+        }
+
+        const auto ready = [this] { return _signaled || has_pending(); };
+
+        if (deadline == INT64_MAX) {
+            _wake.wait(lock, ready);
+        } else {
+            _wake.wait_for(lock, std::chrono::microseconds(deadline - now), ready);
+        }
+
+        _signaled = false;
+    }
+
+    process();
+}
+
+void Queue::wake_after(uint32_t delay_ms) {
+    if (delay_ms == UINT32_MAX) {
+        return;
+    }
+
+    const auto wake_at = Clock::now_us() + int64_t(delay_ms) * 1000;
+
+    bool earlier;
+    {
+        std::lock_guard lock(_mutex);
+
+        earlier = wake_at < _wake_at;
+        if (earlier) {
+            _wake_at = wake_at;
+        }
+    }
+
+    if (earlier) {
+        notify();
     }
 }
 
+QueueStats Queue::get_stats() {
+    QueueStats stats = {};
+
+    std::lock_guard lock(_mutex);
+
+    for (size_t i = 0; i < QUEUE_PRIORITY_COUNT; i++) {
+        auto& lane = _lanes[i];
+        auto& lane_stats = stats.lanes[i];
+
+        lane_stats.depth = uint32_t(lane.entries.size());
+        lane_stats.depth_peak = lane.depth_peak;
+        lane_stats.processed = lane.processed;
+        lane_stats.latency_max_us = lane.latency_max_us;
+        if (lane.processed) {
+            lane_stats.latency_avg_us = uint32_t(lane.latency_total_us / lane.processed);
+        }
+    }
+
+    stats.oversized = _oversized.load(std::memory_order_relaxed);
+
+    return stats;
+}
+
+void Queue::handled_delayed_enqueues() {
+    auto now = Clock::now_us();
+
+    TimerHandle handle;
+    while (_timers.pop_due(now, handle)) {
+        enqueue([this, handle] { run_timer(handle); }, false /* wait */);
+    }
+}
+
+bool Queue::run_next(QueuePriority priority) {
+    std::unique_lock lock(_mutex);
+
+    auto& lane = _lanes[int(priority)];
+    if (lane.entries.empty()) {
+        return false;
+    }
+
+    auto entry = std::move(lane.entries.front());
+    lane.entries.pop_front();
+
+    const auto latency = uint32_t(std::min(Clock::get_system_time_us() - entry.enqueued_at, int64_t(UINT32_MAX)));
+
+    lane.processed++;
+    lane.latency_total_us += latency;
+    lane.latency_max_us = std::max(lane.latency_max_us, latency);
+
+    lock.unlock();
+
+    _not_full.notify_all();
+
+    entry.task();
+
+    return true;
+}
+
+// Call sites are only recorded by the instrumentation of the FreeRTOS implementation.
+TimerHandle Queue::schedule(Task task, uint32_t delay_ms, uint32_t period_ms, void* /* caller */) {
+    if (!task.is_inline()) {
+        _oversized.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    auto payload = new Task(std::move(task));
+
+    const auto handle =
+        _timers.schedule(payload, Clock::now_us() + int64_t(delay_ms) * 1000, int64_t(period_ms) * 1000);
+    if (!handle.is_valid()) {
+        ESP_LOGW(TAG, "All %d timers are in use", CONFIG_ESP_SUPPORT_QUEUE_MAX_TIMERS);
+
+        delete payload;
+        return {};
+    }
+
+    notify();
+
+    return handle;
+}
+
+void Queue::run_timer(TimerHandle handle) {
+    bool cancelled;
+    auto task = (Task*)_timers.acquire(handle, cancelled);
+    if (!task) {
+        return;
+    }
+
+    if (!cancelled) {
+        (*task)();
+
+        if (!_timers.complete(handle, Clock::now_us())) {
+            return;
+        }
+    }
+
+    delete task;
+}
+
+bool Queue::has_pending() {
+    // Called with the mutex held.
+    for (auto& lane : _lanes) {
+        if (!lane.entries.empty()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Queue::notify() {
+    {
+        std::lock_guard lock(_mutex);
+
+        if (std::this_thread::get_id() == _process_thread) {
+            return;
+        }
+
+        _signaled = true;
+    }
+
+    _wake.notify_one();
+}
+
 #endif
@@ -0,0 +1,238 @@
+#include "TimerScheduler.h"
+
+TimerScheduler::TimerScheduler() {
+    for (size_t i = 0; i < CAPACITY; i++) {
+        _timers[i].link = i + 1 < CAPACITY ? uint16_t(i + 1) : NONE;
+        _timers[i].generation = 1;
+    }
+}
+
+TimerHandle TimerScheduler::schedule(void* payload, int64_t deadline, int64_t period_us) {
+    lock();
+
+    const auto index = _free_head;
+    if (index == NONE) {
+        unlock();
+        return {};
+    }
+
+    auto& timer = _timers[index];
+    _free_head = timer.link;
+
+    timer.deadline = deadline;
+    timer.period_us = period_us;
+    timer.payload = payload;
+    timer.state = State::Scheduled;
+
+    push(index);
+
+    const TimerHandle handle(index, timer.generation);
+
+    unlock();
+
+    return handle;
+}
+
+bool TimerScheduler::cancel(TimerHandle handle, void*& payload) {
+    payload = nullptr;
+
+    lock();
+
+    auto timer = get(handle);
+    auto pending = false;
+
+    if (timer) {
+        switch (timer->state) {
+            case State::Scheduled:
+                remove(timer->link);
+                payload = timer->payload;
+                release(handle._index);
+                pending = true;
+                break;
+
+            case State::Fired:
+            case State::Running:
+                timer->state = State::Cancelled;
+                pending = true;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    unlock();
+
+    return pending;
+}
+
+bool TimerScheduler::pop_due(int64_t now, TimerHandle& handle) {
+    lock();
+
+    if (!_heap_size || _timers[_heap[0]].deadline > now) {
+        unlock();
+        return false;
+    }
+
+    const auto index = _heap[0];
+    remove(0);
+
+    auto& timer = _timers[index];
+    timer.state = State::Fired;
+    handle = TimerHandle(index, timer.generation);
+
+    unlock();
+
+    return true;
+}
+
+void* TimerScheduler::acquire(TimerHandle handle, bool& cancelled) {
+    lock();
+
+    auto timer = get(handle);
+    void* payload = nullptr;
+    cancelled = false;
+
+    if (timer) {
+        payload = timer->payload;
+
+        if (timer->state == State::Cancelled) {
+            cancelled = true;
+            release(handle._index);
+        } else {
+            timer->state = State::Running;
+        }
+    }
+
+    unlock();
+
+    return payload;
+}
+
+bool TimerScheduler::complete(TimerHandle handle, int64_t now) {
+    lock();
+
+    auto timer = get(handle);
+    auto released = true;
+
+    if (timer) {
+        if (timer->state == State::Running && timer->period_us) {
+            // Keep the cadence of the timer, unless we've fallen behind more than a period.
+            timer->deadline += timer->period_us;
+            if (timer->deadline <= now) {
+                timer->deadline = now + timer->period_us;
+            }
+            timer->state = State::Scheduled;
+
+            push(handle._index);
+
+            released = false;
+        } else {
+            release(handle._index);
+        }
+    }
+
+    unlock();
+
+    return released;
+}
+
+int64_t TimerScheduler::next_deadline() {
+    lock();
+
+    const auto deadline = _heap_size ? _timers[_heap[0]].deadline : INT64_MAX;
+
+    unlock();
+
+    return deadline;
+}
+
+TimerScheduler::Timer* TimerScheduler::get(TimerHandle handle) {
+    if (!handle.is_valid() || handle._index >= CAPACITY) {
+        return nullptr;
+    }
+
+    auto& timer = _timers[handle._index];
+    if (timer.generation != handle._generation || timer.state == State::Free) {
+        return nullptr;
+    }
+
+    return &timer;
+}
+
+void TimerScheduler::release(uint16_t index) {
+    auto& timer = _timers[index];
+
+    timer.state = State::Free;
+    timer.payload = nullptr;
+
+    // Invalidate outstanding handles. Generation 0 is reserved for invalid handles.
+    if (++timer.generation == 0) {
+        timer.generation = 1;
+    }
+
+    timer.link = _free_head;
+    _free_head = index;
+}
+
+void TimerScheduler::swap(uint16_t a, uint16_t b) {
+    const auto index = _heap[a];
+    _heap[a] = _heap[b];
+    _heap[b] = index;
+
+    _timers[_heap[a]].link = a;
+    _timers[_heap[b]].link = b;
+}
+
+void TimerScheduler::push(uint16_t index) {
+    const auto position = _heap_size++;
+
+    _heap[position] = index;
+    _timers[index].link = position;
+
+    sift_up(position);
+}
+
+void TimerScheduler::remove(uint16_t position) {
+    const auto last = --_heap_size;
+
+    if (position != last) {
+        swap(position, last);
+
+        sift_up(position);
+        sift_down(position);
+    }
+}
+
+void TimerScheduler::sift_up(uint16_t position) {
+    while (position > 0) {
+        const auto parent = uint16_t((position - 1) / 2);
+        if (!less(position, parent)) {
+            break;
+        }
+
+        swap(position, parent);
+        position = parent;
+    }
+}
+
+void TimerScheduler::sift_down(uint16_t position) {
+    while (true) {
+        const auto left = uint16_t(position * 2 + 1);
+        const auto right = uint16_t(left + 1);
+        auto smallest = position;
+
+        if (left < _heap_size && less(left, smallest)) {
+            smallest = left;
+        }
+        if (right < _heap_size && less(right, smallest)) {
+            smallest = right;
+        }
+        if (smallest == position) {
+            break;
+        }
+
+        swap(position, smallest);
+        position = smallest;
+    }
+}
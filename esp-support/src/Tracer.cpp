@@ -0,0 +1,153 @@
+#include "Tracer.h"
+
+#if CONFIG_ESP_SUPPORT_TRACE
+
+#include <atomic>
+#include <cinttypes>
+#include <memory>
+
+#include "RingBuffer.h"
+#include "StringBuilder.h"
+#include "error.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+[[maybe_unused]] static const char* TAG = "Tracer";
+
+// Chunks are handed to the sink once they grow past this size.
+static constexpr size_t CHUNK_SIZE = 768;
+
+static MpscRingBuffer<TraceEvent, CONFIG_ESP_SUPPORT_TRACE_BUFFER_SIZE> buffers[portNUM_PROCESSORS];
+static std::atomic<uint32_t> dropped;
+static std::atomic<bool> dumping;
+
+void Tracer::record(TraceEventType type, const char* name) {
+    const auto in_isr = xPortInIsrContext();
+
+    const TraceEvent event = {
+        .name = name,
+        .task = in_isr ? nullptr : xTaskGetCurrentTaskHandle(),
+        .time_us = uint32_t(esp_timer_get_time()),
+        .type = type,
+    };
+
+    if (!buffers[xPortGetCoreID()].push(event)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+uint32_t Tracer::get_dropped() { return dropped.load(std::memory_order_relaxed); }
+
+static const char* get_phase(TraceEventType type) {
+    switch (type) {
+        case TraceEventType::Begin:
+            return "B";
+        case TraceEventType::End:
+            return "E";
+        default:
+            return "i";
+    }
+}
+
+// Thread ids of the trace are task handles. Events recorded by ISRs get the core number
+// instead, which can't collide with a task handle.
+static uintptr_t get_thread_id(const TraceEvent& event, size_t core) {
+    return event.task ? uintptr_t(event.task) : uintptr_t(core);
+}
+
+esp_err_t Tracer::dump(const Sink& sink) {
+    if (dumping.exchange(true)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    DEFER(dumping = false);
+
+    StringBuilder<CHUNK_SIZE + 128> chunk;
+    auto first = true;
+
+    const auto append_separator = [&]() {
+        chunk.append(first ? "[\n" : ",\n");
+        first = false;
+    };
+
+    const auto flush = [&](bool force) {
+        if (chunk.empty() || (!force && chunk.length() < CHUNK_SIZE)) {
+            return ESP_OK;
+        }
+
+        const auto err = sink(chunk.view());
+        chunk.clear();
+        return err;
+    };
+
+    for (size_t core = 0; core < portNUM_PROCESSORS; core++) {
+        append_separator();
+        chunk.appendf(R"({"name":"thread_name","ph":"M","pid":0,"tid":%u,"args":{"name":"ISR core %u"}})",
+                      unsigned(core), unsigned(core));
+    }
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    // Name the tasks that are still alive. Others show up by their handle.
+    const auto task_count = uxTaskGetNumberOfTasks();
+    const auto tasks = std::make_unique<TaskStatus_t[]>(task_count);
+    const auto count = uxTaskGetSystemState(tasks.get(), task_count, nullptr);
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        append_separator();
+        chunk.appendf(R"({"name":"thread_name","ph":"M","pid":0,"tid":%u,"args":{"name":"%s"}})",
+                      unsigned(uintptr_t(tasks[i].xHandle)), tasks[i].pcTaskName);
+        ESP_ERROR_RETURN(flush(false));
+    }
+#endif
+
+    for (size_t core = 0; core < portNUM_PROCESSORS; core++) {
+        TraceEvent event;
+        while (buffers[core].pop(event)) {
+            append_separator();
+            chunk.appendf(R"({"name":"%s","ph":"%s","ts":%)" PRIu32 R"(,"pid":0,"tid":%u)", event.name,
+                          get_phase(event.type), event.time_us, unsigned(get_thread_id(event, core)));
+            // Instant events are scoped to their thread.
+            chunk.append(event.type == TraceEventType::Instant ? R"(,"s":"t"})" : "}");
+
+            ESP_ERROR_RETURN(flush(false));
+        }
+    }
+
+    chunk.append(first ? "[]\n" : "\n]\n");
+
+    return flush(true);
+}
+
+esp_err_t Tracer::dump_to_partition(const char* label) {
+    const auto partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (!partition) {
+        ESP_LOGE(TAG, "Cannot find partition %s", label);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    ESP_ERROR_RETURN(esp_partition_erase_range(partition, 0, partition->size));
+
+    size_t offset = 0;
+
+    return dump([partition, &offset](std::string_view chunk) {
+        ESP_ASSERT_RETURN(offset + chunk.size() <= partition->size, ESP_ERR_INVALID_SIZE);
+
+        ESP_ERROR_RETURN(esp_partition_write(partition, offset, chunk.data(), chunk.size()));
+        offset += chunk.size();
+
+        return ESP_OK;
+    });
+}
+
+#else
+
+void Tracer::record(TraceEventType type, const char* name) {}
+
+esp_err_t Tracer::dump(const Sink& sink) { return ESP_ERR_NOT_SUPPORTED; }
+
+esp_err_t Tracer::dump_to_partition(const char* label) { return ESP_ERR_NOT_SUPPORTED; }
+
+uint32_t Tracer::get_dropped() { return 0; }
+
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include "Span.h"
+#include "esp_err.h"
+#include "esp_partition.h"
+
+// Read-only data partition built by raw_partition() with the HEADER or ASSETS option.
+// The partition is memory mapped, so the views it hands out point straight into flash
+// and stay valid until end() is called.
+//
+// The layout is written by cmake/asset_partition.py. All integers are little endian:
+//
+//   Header   magic, version, flags, asset count, size and CRC32 of everything after the
+//            header
+//   Index    asset count entries with a name, flags, and the offset and size of the asset
+//   Data     the assets, each aligned to four bytes
+//
+// A partition built with HEADER holds a single unnamed asset and has no index. With
+// COMPRESS, every asset is compressed on its own; read those through an LzssDecoder.
+// Assets that compression wouldn't make smaller are stored as is, so check
+// is_compressed() for each of them.
+class AssetPartition {
+    static constexpr uint32_t MAGIC = 0x54455341;  // "ASET"
+    static constexpr uint8_t VERSION = 1;
+    // In the header of a partition without index, and in the entries of an index.
+    static constexpr uint8_t FLAG_COMPRESSED = 1 << 0;
+
+    struct Header {
+        uint32_t magic;
+        uint8_t version;
+        uint8_t flags;
+        uint16_t asset_count;
+        uint32_t size;
+        uint32_t crc32;
+    };
+
+    struct Entry {
+        // Null terminated.
+        char name[23];
+        uint8_t flags;
+        // Relative to the end of the header.
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    static_assert(sizeof(Header) == 16, "Header must match asset_partition.py");
+    static_assert(sizeof(Entry) == 32, "Entry must match asset_partition.py");
+
+    esp_partition_mmap_handle_t _mmap_handle{};
+    const Header* _header{};
+    const Entry* _entries{};
+
+public:
+    AssetPartition() = default;
+    ~AssetPartition() { end(); }
+
+    AssetPartition(const AssetPartition&) = delete;
+    AssetPartition& operator=(const AssetPartition&) = delete;
+
+    // Maps the data partition with the label and validates the header and index. The CRC
+    // covers the whole partition, so skip it if mapping has to be fast.
+    esp_err_t begin(const char* label, bool verify_crc = true);
+    void end();
+
+    bool is_mapped() const { return _header; }
+    // Contents of a partition without index.
+    ByteView get_data() const;
+    // Whether get_data() holds an LZSS stream instead of the data itself.
+    bool is_compressed() const { return _header && (_header->flags & FLAG_COMPRESSED); }
+
+    size_t get_count() const { return _header ? _header->asset_count : 0; }
+    std::string_view get_name(size_t index) const;
+    ByteView get(size_t index) const;
+    // Whether get(index) holds an LZSS stream instead of the asset itself.
+    bool is_compressed(size_t index) const;
+    // Returns an empty view if there's no asset with the name.
+    ByteView find(std::string_view name) const;
+
+private:
+    const uint8_t* get_payload() const { return (const uint8_t*)(_header + 1); }
+    esp_err_t validate(bool verify_crc);
+};
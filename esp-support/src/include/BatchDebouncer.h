@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Callback.h"
+#include "driver/gpio.h"
+
+// Debounces up to 32 inputs at once. Every tick, all pins are sampled with a single
+// read of the GPIO input register and run through a vertical counter: a two bit counter
+// per input, stored as two bit planes, so all inputs are debounced with a handful of
+// bitwise operations. An input changes once it has differed from its debounced state
+// for four consecutive ticks.
+//
+// Only GPIO 0 to 31 can be used, since they share a single input register.
+class BatchDebouncer {
+    Queue* _queue;
+    uint32_t _tick_ms;
+    uint32_t _pins{};
+    uint32_t _inverted{};
+    uint32_t _state{};
+    // Low and high bit of the counter of every input.
+    uint32_t _count_low{};
+    uint32_t _count_high{};
+    uint32_t _changed{};
+    TimerHandle _timer;
+    Callback<uint32_t> _changed_callback;
+
+public:
+    BatchDebouncer(Queue* queue, uint32_t tick_ms = 5) : _queue(queue), _tick_ms(tick_ms) {}
+
+    BatchDebouncer(const BatchDebouncer&) = delete;
+    BatchDebouncer& operator=(const BatchDebouncer&) = delete;
+
+    // Configures the pin as an input. Must be called before begin().
+    void add(gpio_num_t pin, bool inverted = false, gpio_pull_mode_t pull_mode = GPIO_FLOATING);
+
+    // Takes the current levels as the debounced state and samples the pins every tick
+    // on the queue. Returns ESP_ERR_NO_MEM if the queue has no timer left.
+    esp_err_t begin();
+    void end();
+
+    // Samples all pins once. Returns the mask of pins whose debounced state changed.
+    uint32_t update();
+
+    // Debounced state of all pins, after inversion. Bit n is GPIO n.
+    uint32_t read() const { return _state; }
+    // Pins that changed on the last update.
+    uint32_t changed() const { return _changed; }
+
+    bool read(gpio_num_t pin) const { return _state & (1u << pin); }
+    bool rose(gpio_num_t pin) const { return _changed & _state & (1u << pin); }
+    bool fell(gpio_num_t pin) const { return _changed & ~_state & (1u << pin); }
+
+    // Called with the mask of changed pins whenever the state of any pin changes.
+    CallbackToken on_changed(Callback<uint32_t>::Function func) { return _changed_callback.add(std::move(func)); }
+
+private:
+    uint32_t sample() const;
+};
@@ -75,6 +75,8 @@ public:
 */
     Debouncer() {}
 
+    virtual ~Debouncer() = default;
+
     /**
 @brief  Sets the debounce interval in milliseconds.
 
@@ -93,7 +95,15 @@ as often as possible (that means to include it in your loop()). Only call update
 @return True if the pin changed state.
 */
 
-    bool update();
+    virtual bool update();
+
+    /*!
+@brief   Returns whether update() has to be called as often as possible to notice changes.
+
+Debouncers that are driven by interrupts return false. Their update() only has to be called after they have signaled a
+change.
+*/
+    virtual bool needsPolling() const { return true; }
 
     /**
      @brief Returns the pin's state (HIGH or LOW).
@@ -155,6 +165,17 @@ public:
 protected:
     void begin();
     virtual bool readCurrentState() = 0;
+    /*!
+@brief   Applies a state that was debounced elsewhere, e.g. from an interrupt.
+
+@param    currentState
+        The debounced state.
+@param    changedAt
+        The time in milliseconds at which the state changed.
+
+@return True if the state changed.
+*/
+    bool applyState(bool currentState, unsigned long changedAt);
     unsigned long previous_millis{};
     uint16_t interval_millis{10};
     uint8_t state{};
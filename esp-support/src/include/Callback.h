@@ -1,122 +1,284 @@
 #pragma once
 
 #include <atomic>
-#include <functional>
+#include <mutex>
+#include <type_traits>
 
+#include "InlineFunction.h"
 #include "Queue.h"
 
-template <typename Arg>
-class Callback {
+// Identifies a listener added to a Callback. 0 is never handed out.
+using CallbackToken = uint32_t;
+
+// Lock-free list of listeners. Adding and calling don't take locks. Removing takes a
+// mutex to serialize unlinking, and only frees a node once no call() can still be
+// walking over it.
+template <typename... Args>
+class CallbackList {
+public:
+    using Function = InlineFunction<void(Args...)>;
+
+protected:
     struct Node {
-        std::function<void(Arg)> func;
-        Node* next;
+        Function func;
+        std::atomic<Node*> next;
+        std::atomic<bool> removed;
+        CallbackToken token;
+        // Next node in the retired list once the node has been unlinked.
+        Node* retired_next;
 
-        Node(std::function<void(Arg)> func, Node* next) : func(std::move(func)), next(next) {}
+        Node(Function func, CallbackToken token)
+            : func(std::move(func)), next(nullptr), removed(false), token(token), retired_next(nullptr) {}
     };
 
     std::atomic<Node*> _head{nullptr};
+    std::atomic<CallbackToken> _next_token{1};
+    // Number of calls walking the list. Nodes are only freed when this is 0.
+    mutable std::atomic<uint32_t> _active_calls{};
+    // Unlinked nodes waiting to be freed. Only modified with the mutex held.
+    mutable std::atomic<Node*> _retired{nullptr};
+    mutable std::mutex _mutex;
 
 public:
+    CallbackList() = default;
+    CallbackList(const CallbackList&) = delete;
+    CallbackList& operator=(const CallbackList&) = delete;
+
     // Not thread-safe vs concurrent add/call.
-    ~Callback() {
-        auto n = _head.load(std::memory_order_relaxed);
-        while (n) {
-            auto next = n->next;
-            delete n;
-            n = next;
+    ~CallbackList() {
+        auto node = _head.load(std::memory_order_relaxed);
+        while (node) {
+            auto next = node->next.load(std::memory_order_relaxed);
+            delete node;
+            node = next;
         }
+
+        delete_retired(_retired.load(std::memory_order_relaxed));
     }
 
-    void add(std::function<void(Arg)> func) {
-        auto node = new Node(std::move(func), nullptr);
+    CallbackToken add(Function func) {
+        auto token = _next_token.fetch_add(1, std::memory_order_relaxed);
+        if (!token) {
+            token = _next_token.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        auto node = new Node(std::move(func), token);
 
         // Treiber push: publish n as new head.
         Node* old = _head.load(std::memory_order_relaxed);
         do {
-            node->next = old;  // only this thread writes n->next, before publish
-        } while (!_head.compare_exchange_weak(old, node,
-                                              std::memory_order_release,  // publish node contents (func + next)
-                                              std::memory_order_relaxed   // on failure, just retry
-                                              ));
+            node->next.store(old, std::memory_order_relaxed);  // only this thread writes n->next, before publish
+        } while (!_head.compare_exchange_weak(old, node));
+
+        return token;
     }
 
-    bool call(Arg arg) const {
-        // Snapshot head. Acquire pairs with add()'s release so the constructed
-        // node (func/next) is visible to this thread.
+    // Removes a listener. Calls that start after this returns won't invoke it anymore;
+    // calls already running skip it if they haven't reached it yet. Returns false if
+    // the token is unknown or was already removed.
+    bool remove(CallbackToken token) {
+        if (!token) {
+            return false;
+        }
 
-        auto node = _head.load(std::memory_order_acquire);
+        std::lock_guard lock(_mutex);
+
+        Node* prev = nullptr;
+        auto node = _head.load();
+        while (node && node->token != token) {
+            prev = node;
+            node = node->next.load();
+        }
 
         if (!node) {
             return false;
         }
 
-        while (node) {
-            node->func(arg);
-            node = node->next;
+        node->removed = true;
+
+        // Calls walking over the node keep working because its next pointer is left
+        // alone. Adds only ever touch the head, so unlinking anything else is safe with
+        // just the mutex.
+        const auto next = node->next.load();
+        if (prev) {
+            prev->next = next;
+        } else {
+            auto expected = node;
+            if (!_head.compare_exchange_strong(expected, next)) {
+                // Listeners were added in front of the node.
+                prev = expected;
+                while (prev->next.load() != node) {
+                    prev = prev->next.load();
+                }
+                prev->next = next;
+            }
         }
 
+        node->retired_next = _retired.load(std::memory_order_relaxed);
+        _retired = node;
+
+        reclaim_locked();
+
         return true;
     }
 
+    bool call(Args... args) const {
+        // The active call count must be visible before we read the head. Removers
+        // check it after unlinking, so either they see us or we don't see their node.
+        _active_calls.fetch_add(1);
+
+        auto node = _head.load();
+        const auto result = node != nullptr;
+
+        while (node) {
+            if (!node->removed.load(std::memory_order_relaxed)) {
+                node->func(args...);
+            }
+            node = node->next.load();
+        }
+
+        end_call();
+
+        return result;
+    }
+
+protected:
+    void end_call() const {
+        if (_active_calls.fetch_sub(1) == 1 && _retired.load()) {
+            std::lock_guard lock(_mutex);
+
+            reclaim_locked();
+        }
+    }
+
+private:
+    void reclaim_locked() const {
+        if (_active_calls.load()) {
+            // The last call to finish reclaims.
+            return;
+        }
+
+        delete_retired(_retired.exchange(nullptr));
+    }
+
+    static void delete_retired(Node* node) {
+        while (node) {
+            auto next = node->retired_next;
+            delete node;
+            node = next;
+        }
+    }
+};
+
+template <typename Arg>
+class Callback : public CallbackList<Arg> {
+public:
     void queue(Queue* queue, Arg arg) {
-        queue->enqueue([this, arg] { call(arg); });
+        queue->enqueue([this, arg] { this->call(arg); });
     }
 };
 
 template <>
-class Callback<void> {
-    struct Node {
-        std::function<void()> func;
-        Node* next;
+class Callback<void> : public CallbackList<> {
+public:
+    void queue(Queue* queue) {
+        queue->enqueue([this] { call(); });
+    }
+
+    // Stops a queue_each() chain when it returns true. It's stored inline, so keep its
+    // captures to a pointer and an integer.
+    using Cancelled = InlineFunction<bool(), 2 * sizeof(void*)>;
 
-        Node(std::function<void()> func, Node* next) : func(std::move(func)), next(next) {}
+    // Queues every listener as a separate task, one after the other, and queues done
+    // after the last one. Use this for listeners that do a lot of work so that
+    // higher priority tasks can run in between. cancelled is checked before every
+    // listener and before queuing done; once it returns true, the rest of the chain is
+    // dropped.
+    void queue_each(Queue* queue, QueuePriority priority, Queue::Task done = nullptr, Cancelled cancelled = nullptr) {
+        // Counts as a single call until the last listener has run, so removed
+        // listeners aren't freed while the chain still references them.
+        _active_calls.fetch_add(1);
+
+        queue_from(new Chain{this, queue, priority, std::move(done), std::move(cancelled)}, _head.load());
+    }
+
+private:
+    // Shared by the tasks of a queue_each() chain, so that each of them only captures two
+    // pointers and fits the inline storage of a queue slot.
+    struct Chain {
+        Callback* callback;
+        Queue* queue;
+        QueuePriority priority;
+        Queue::Task done;
+        Cancelled cancelled;
+
+        bool is_cancelled() { return cancelled && cancelled(); }
     };
 
-    std::atomic<Node*> _head{nullptr};
+    void queue_from(Chain* chain, Node* node) {
+        while (node && node->removed.load(std::memory_order_relaxed)) {
+            node = node->next.load();
+        }
 
-public:
-    // Not thread-safe vs concurrent add/call.
-    ~Callback() {
-        auto n = _head.load(std::memory_order_relaxed);
-        while (n) {
-            auto next = n->next;
-            delete n;
-            n = next;
+        if (!node) {
+            end_call();
+
+            if (chain->done && !chain->is_cancelled()) {
+                chain->queue->enqueue(std::move(chain->done), chain->priority);
+            }
+            delete chain;
+            return;
         }
-    }
 
-    void add(std::function<void()> func) {
-        auto node = new Node(std::move(func), nullptr);
+        auto task = [chain, node] {
+            if (chain->is_cancelled()) {
+                chain->callback->end_call();
+                delete chain;
+                return;
+            }
 
-        // Treiber push: publish n as new head.
-        Node* old = _head.load(std::memory_order_relaxed);
-        do {
-            node->next = old;  // only this thread writes n->next, before publish
-        } while (!_head.compare_exchange_weak(old, node,
-                                              std::memory_order_release,  // publish node contents (func + next)
-                                              std::memory_order_relaxed   // on failure, just retry
-                                              ));
+            if (!node->removed.load(std::memory_order_relaxed)) {
+                node->func();
+            }
+            chain->callback->queue_from(chain, node->next.load());
+        };
+        static_assert(sizeof(task) <= CONFIG_ESP_SUPPORT_QUEUE_TASK_INLINE_SIZE, "Chain tasks must be stored inline");
+
+        chain->queue->enqueue(std::move(task), chain->priority);
     }
+};
 
-    bool call() const {
-        // Snapshot head. Acquire pairs with add()'s release so the constructed
-        // node (func/next) is visible to this thread.
+// Callback for high rate value streams. Values queued while an earlier one is still
+// waiting on the queue replace it, so a producer never has more than one task on the
+// queue and never blocks on a full queue. Listeners only get the latest value.
+template <typename Arg>
+class CoalescedCallback : public Callback<Arg> {
+    static_assert(std::is_trivially_copyable_v<Arg>, "Arg must be trivially copyable");
 
-        auto node = _head.load(std::memory_order_acquire);
+    std::atomic<Arg> _value{};
+    std::atomic<bool> _pending{};
+    std::atomic<uint32_t> _dropped{};
 
-        if (!node) {
-            return false;
-        }
+public:
+    void queue(Queue* queue, Arg arg, QueuePriority priority = QueuePriority::Interactive) {
+        _value = arg;
 
-        while (node) {
-            node->func();
-            node = node->next;
+        if (_pending.exchange(true)) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
         }
 
-        return true;
-    }
+        queue->enqueue(
+            [this] {
+                // Clear the flag before reading the value. A value stored after
+                // this gets a new task.
+                _pending = false;
 
-    void queue(Queue* queue) {
-        queue->enqueue([this] { call(); });
+                this->call(_value.load());
+            },
+            priority);
     }
+
+    // Number of values that were replaced before they were delivered.
+    uint32_t get_dropped() const { return _dropped.load(std::memory_order_relaxed); }
 };
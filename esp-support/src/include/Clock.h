@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#ifdef LV_SIMULATOR
+#include <chrono>
+#else
+#include "esp_timer.h"
+#endif
+
+// Monotonic time source of the libraries. Time dependent code reads the time through
+// Clock::now_us() and Clock::now_ms() instead of esp_timer_get_time(), so a test or
+// benchmark can install a VirtualClock and fast-forward through debouncing, transitions
+// and timeouts instead of waiting for them.
+//
+// Code that measures how long something really took (profiling, tracing) and ISRs keep
+// using esp_timer_get_time() directly.
+class Clock {
+    static inline std::atomic<Clock*> _installed{};
+
+public:
+    virtual ~Clock() = default;
+
+    virtual int64_t get_time_us() = 0;
+
+    // Time since boot, or the time of the installed clock.
+    static int64_t now_us() {
+        const auto clock = _installed.load(std::memory_order_acquire);
+        return clock ? clock->get_time_us() : get_system_time_us();
+    }
+    static int64_t now_ms() { return now_us() / 1000; }
+
+    // Installs the clock used by now_us() and now_ms(). Pass nullptr to go back to the
+    // system clock. The clock must outlive its installation.
+    static void install(Clock* clock) { _installed.store(clock, std::memory_order_release); }
+
+    static int64_t get_system_time_us() {
+#ifdef LV_SIMULATOR
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#else
+        return esp_timer_get_time();
+#endif
+    }
+};
+
+class SystemClock : public Clock {
+public:
+    int64_t get_time_us() override { return get_system_time_us(); }
+};
+
+// Clock that only moves when it's told to.
+class VirtualClock : public Clock {
+    std::atomic<int64_t> _time_us;
+
+public:
+    explicit VirtualClock(int64_t time_us = 0) : _time_us(time_us) {}
+
+    int64_t get_time_us() override { return _time_us.load(std::memory_order_relaxed); }
+
+    void set_time_us(int64_t time_us) { _time_us.store(time_us, std::memory_order_relaxed); }
+    void advance_us(int64_t delta_us) { _time_us.fetch_add(delta_us, std::memory_order_relaxed); }
+    void advance_ms(int64_t delta_ms) { advance_us(delta_ms * 1000); }
+};
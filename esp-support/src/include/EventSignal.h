@@ -0,0 +1,56 @@
+#pragma once
+
+#include "error.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+// Signal that carries up to 24 independent reasons as bits, e.g. new data, a
+// connectivity change and shutdown. A waiter gets all reasons that were signaled since
+// its last wait in one go.
+class EventSignal {
+    EventGroupHandle_t _group;
+
+public:
+    // FreeRTOS reserves the top byte of the event bits.
+    static constexpr EventBits_t ALL_BITS = 0x00ffffff;
+
+    EventSignal() {
+        _group = xEventGroupCreate();
+        ESP_ASSERT_CHECK(_group);
+    }
+
+    ~EventSignal() { vEventGroupDelete(_group); }
+
+    EventSignal(const EventSignal&) = delete;
+    EventSignal& operator=(const EventSignal&) = delete;
+
+    void signal(EventBits_t bits) { xEventGroupSetBits(_group, bits); }
+
+    // Setting bits from an ISR is deferred to the timer service task, so the waiter
+    // wakes up a little later than with Signal::signal_from_isr(). Returns false if the
+    // timer command queue is full and the bits were not set.
+    bool signal_from_isr(EventBits_t bits) {
+        BaseType_t higher_priority_task_woken = pdFALSE;
+        const auto result = xEventGroupSetBitsFromISR(_group, bits, &higher_priority_task_woken);
+        portYIELD_FROM_ISR(higher_priority_task_woken);
+        return result == pdPASS;
+    }
+
+    // Waits until any of bits is signaled. Returns and clears the signaled bits, or
+    // returns 0 on timeout.
+    EventBits_t wait_any(EventBits_t bits = ALL_BITS, TickType_t timeout = portMAX_DELAY) {
+        return xEventGroupWaitBits(_group, bits, pdTRUE, pdFALSE, timeout) & bits;
+    }
+
+    // Waits until all of bits are signaled. Returns and clears bits, or returns 0 on
+    // timeout. Bits that were signaled before the timeout stay set.
+    EventBits_t wait_all(EventBits_t bits, TickType_t timeout = portMAX_DELAY) {
+        const auto result = xEventGroupWaitBits(_group, bits, pdTRUE, pdTRUE, timeout);
+        return (result & bits) == bits ? bits : 0;
+    }
+
+    // Bits that are currently signaled, without clearing them.
+    EventBits_t peek() const { return xEventGroupGetBits(_group) & ALL_BITS; }
+
+    void clear(EventBits_t bits) { xEventGroupClearBits(_group, bits); }
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <utility>
+
+#include "StaticRegistry.h"
+
+#ifndef LV_SIMULATOR
+#include "sdkconfig.h"
+#endif
+
+struct HeapAccountStats {
+    const char* name;
+    uint32_t live_bytes;
+    uint32_t peak_bytes;
+    uint32_t allocations;
+    uint32_t frees;
+};
+
+// Named account that heap allocations of a component are charged to, so a downward
+// trend in free heap can be traced back to the component responsible. Accounts are
+// listed from their first charge and are never removed, so they must be statically
+// allocated, e.g.
+//
+//   static HeapAccount heap_account("log_manager");
+//
+// Allocations are charged explicitly through allocate(), create() or HeapAccountAllocator;
+// nested allocations, like the buffer of a std::string in a charged container, aren't.
+//
+// Accounting is enabled with CONFIG_ESP_SUPPORT_HEAP_ACCOUNTING. Without it, accounts are
+// empty, charging compiles to nothing and the helpers are plain malloc() and new.
+class HeapAccount
+#if CONFIG_ESP_SUPPORT_HEAP_ACCOUNTING
+    : public StaticRegistry<HeapAccount>::Node
+#endif
+{
+#if CONFIG_ESP_SUPPORT_HEAP_ACCOUNTING
+    // Blocks from allocate() are prefixed with their size, padded to keep the block aligned.
+    static constexpr size_t HEADER_SIZE = alignof(std::max_align_t);
+
+    const char* _name;
+    std::atomic<uint32_t> _live_bytes{};
+    std::atomic<uint32_t> _peak_bytes{};
+    std::atomic<uint32_t> _allocations{};
+    std::atomic<uint32_t> _frees{};
+#endif
+
+public:
+    // Constant initialized, so allocations charged before static initialization reaches
+    // the account are kept.
+#if CONFIG_ESP_SUPPORT_HEAP_ACCOUNTING
+    explicit constexpr HeapAccount(const char* name) : _name(name) {}
+#else
+    explicit constexpr HeapAccount(const char*) {}
+#endif
+
+    HeapAccount(const HeapAccount&) = delete;
+    HeapAccount& operator=(const HeapAccount&) = delete;
+
+#if CONFIG_ESP_SUPPORT_HEAP_ACCOUNTING
+    void charge(size_t size) {
+        if (!is_added()) {
+            add_to_registry();
+        }
+
+        _allocations.fetch_add(1, std::memory_order_relaxed);
+
+        const auto live = _live_bytes.fetch_add(uint32_t(size), std::memory_order_relaxed) + uint32_t(size);
+
+        auto peak = _peak_bytes.load(std::memory_order_relaxed);
+        while (live > peak && !_peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+    }
+
+    void release(size_t size) {
+        _frees.fetch_add(1, std::memory_order_relaxed);
+        _live_bytes.fetch_sub(uint32_t(size), std::memory_order_relaxed);
+    }
+
+    // malloc() and free() charged to the account.
+    void* allocate(size_t size);
+    void deallocate(void* block);
+#else
+    void charge(size_t) {}
+    void release(size_t) {}
+
+    void* allocate(size_t size) { return malloc(size); }
+    void deallocate(void* block) { free(block); }
+#endif
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        const auto object = new T(std::forward<Args>(args)...);
+        charge(sizeof(T));
+        return object;
+    }
+
+    template <typename T>
+    void destroy(T* object) {
+        if (object) {
+            release(sizeof(T));
+            delete object;
+        }
+    }
+
+    HeapAccountStats get_stats() const;
+
+    // Fills stats with the statistics of up to max_count accounts that were charged and
+    // returns the number of those accounts. Returns zero when accounting is disabled.
+    static size_t get_all_stats(HeapAccountStats* stats, size_t max_count);
+    static void log_all_stats();
+
+#if CONFIG_ESP_SUPPORT_HEAP_ACCOUNTING
+private:
+    void add_to_registry();
+#endif
+};
+
+#if CONFIG_ESP_SUPPORT_HEAP_ACCOUNTING
+
+// Allocator for standard containers that charges the container's own allocations, e.g.
+// the nodes of a std::map, to Account.
+template <typename T, HeapAccount& Account>
+class HeapAccountAllocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = HeapAccountAllocator<U, Account>;
+    };
+
+    HeapAccountAllocator() = default;
+    template <typename U>
+    HeapAccountAllocator(const HeapAccountAllocator<U, Account>&) noexcept {}
+
+    T* allocate(size_t count) {
+        const auto result = std::allocator<T>().allocate(count);
+        Account.charge(count * sizeof(T));
+        return result;
+    }
+
+    void deallocate(T* pointer, size_t count) {
+        Account.release(count * sizeof(T));
+        std::allocator<T>().deallocate(pointer, count);
+    }
+
+    template <typename U>
+    bool operator==(const HeapAccountAllocator<U, Account>&) const {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const HeapAccountAllocator<U, Account>&) const {
+        return false;
+    }
+};
+
+#else
+
+template <typename T, HeapAccount& Account>
+using HeapAccountAllocator = std::allocator<T>;
+
+#endif
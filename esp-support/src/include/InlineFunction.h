@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename Signature, size_t Capacity = 4 * sizeof(void*)>
+class InlineFunction;
+
+// Move-only, type-erased callable. Callables up to Capacity bytes are stored inline; larger
+// ones are moved to the heap. Use is_inline() to find out which storage a callable ended up in.
+template <typename R, typename... Args, size_t Capacity>
+class InlineFunction<R(Args...), Capacity> {
+    static_assert(Capacity >= sizeof(void*), "Capacity must at least hold a pointer");
+
+    struct Ops {
+        R (*invoke)(void* storage, Args&&... args);
+        // Move constructs the callable into dst and destroys the one in src.
+        void (*relocate)(void* dst, void* src);
+        void (*destroy)(void* storage);
+        // Size of the heap allocation holding the callable, zero if it's stored inline.
+        size_t heap_size;
+    };
+
+    template <typename F>
+    struct InlineOps {
+        static F* get(void* storage) { return std::launder(reinterpret_cast<F*>(storage)); }
+
+        static R invoke(void* storage, Args&&... args) { return (*get(storage))(std::forward<Args>(args)...); }
+
+        static void relocate(void* dst, void* src) {
+            ::new (dst) F(std::move(*get(src)));
+            get(src)->~F();
+        }
+
+        static void destroy(void* storage) { get(storage)->~F(); }
+
+        static constexpr Ops ops = {invoke, relocate, destroy, 0};
+    };
+
+    template <typename F>
+    struct HeapOps {
+        static F*& get(void* storage) { return *std::launder(reinterpret_cast<F**>(storage)); }
+
+        static R invoke(void* storage, Args&&... args) { return (*get(storage))(std::forward<Args>(args)...); }
+
+        static void relocate(void* dst, void* src) { ::new (dst) F*(get(src)); }
+
+        static void destroy(void* storage) { delete get(storage); }
+
+        static constexpr Ops ops = {invoke, relocate, destroy, sizeof(F)};
+    };
+
+    alignas(std::max_align_t) mutable unsigned char _storage[Capacity];
+    const Ops* _ops{};
+
+public:
+    template <typename F>
+    static constexpr bool fits_inline() {
+        return sizeof(F) <= Capacity && alignof(F) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible_v<F>;
+    }
+
+    InlineFunction() = default;
+    InlineFunction(std::nullptr_t) {}
+
+    template <typename F, typename D = std::decay_t<F>,
+              typename = std::enable_if_t<!std::is_same_v<D, InlineFunction> && std::is_invocable_r_v<R, D&, Args...>>>
+    InlineFunction(F&& func) {
+        if constexpr (fits_inline<D>()) {
+            ::new (_storage) D(std::forward<F>(func));
+            _ops = &InlineOps<D>::ops;
+        } else {
+            ::new (_storage) D*(new D(std::forward<F>(func)));
+            _ops = &HeapOps<D>::ops;
+        }
+    }
+
+    InlineFunction(InlineFunction&& other) noexcept : _ops(other._ops) {
+        if (_ops) {
+            _ops->relocate(_storage, other._storage);
+            other._ops = nullptr;
+        }
+    }
+
+    InlineFunction& operator=(InlineFunction&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other._ops) {
+                other._ops->relocate(_storage, other._storage);
+                _ops = other._ops;
+                other._ops = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    InlineFunction& operator=(std::nullptr_t) {
+        reset();
+        return *this;
+    }
+
+    InlineFunction(const InlineFunction&) = delete;
+    InlineFunction& operator=(const InlineFunction&) = delete;
+
+    ~InlineFunction() { reset(); }
+
+    explicit operator bool() const { return _ops != nullptr; }
+
+    bool is_inline() const { return _ops && !_ops->heap_size; }
+    size_t get_heap_size() const { return _ops ? _ops->heap_size : 0; }
+
+    R operator()(Args... args) const { return _ops->invoke(_storage, std::forward<Args>(args)...); }
+
+    void reset() {
+        if (_ops) {
+            _ops->destroy(_storage);
+            _ops = nullptr;
+        }
+    }
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+
+#include "Bounce2.h"
+#include "Callback.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/portmacro.h"
+#include "sdkconfig.h"
+
+#ifndef CONFIG_ESP_SUPPORT_DEBOUNCER_MAX_PINS
+#define CONFIG_ESP_SUPPORT_DEBOUNCER_MAX_PINS 8
+#endif
+
+class InterruptDebouncer;
+
+struct DebouncedEdge {
+    gpio_num_t pin;
+    // Debounced level, after inversion.
+    bool level;
+    // Time of the first edge of the transition.
+    int64_t time_us;
+};
+
+// A pin debounced by an InterruptDebouncer. It has the same accessors as Bounce, but
+// update() only picks up the state the interrupt debouncer confirmed and never reads
+// the pin.
+class DebouncedPin : public Debouncer {
+    InterruptDebouncer* _owner{};
+    gpio_num_t _pin{};
+    bool _inverted{};
+    // Times of the first and last raw edge of the current transition. Truncated to 32 bits
+    // so the ISR can store them atomically. Guarded by the lock of the owner, together with
+    // the pending bit of the pin.
+    std::atomic<uint32_t> _first_edge_us{};
+    std::atomic<uint32_t> _last_edge_us{};
+    // Confirmed state. Guarded by the lock of the owner.
+    bool _stable{};
+    int64_t _stable_since_us{};
+
+public:
+    bool update() override;
+    bool needsPolling() const override { return false; }
+
+    gpio_num_t getPin() const { return _pin; }
+
+protected:
+    bool readCurrentState() override;
+
+    friend class InterruptDebouncer;
+};
+
+// Debounces pins using GPIO edge interrupts. Every edge restarts the debounce interval
+// of its pin. A single esp_timer confirms the level of pins whose interval has passed.
+// Confirmed changes are delivered to the queue, so nothing needs to be polled and the
+// main loop can sleep while the pins are idle.
+class InterruptDebouncer {
+    Queue* _queue;
+    uint32_t _interval_us;
+    DebouncedPin _pins[CONFIG_ESP_SUPPORT_DEBOUNCER_MAX_PINS];
+    size_t _pin_count{};
+    // Bit per pin that has seen an edge that hasn't been confirmed yet.
+    std::atomic<uint32_t> _pending{};
+    std::atomic<bool> _timer_armed{};
+    esp_timer_handle_t _timer{};
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+    Callback<DebouncedEdge> _edge;
+
+    static_assert(CONFIG_ESP_SUPPORT_DEBOUNCER_MAX_PINS <= 32, "Pending pins are tracked in a 32 bit mask");
+
+public:
+    InterruptDebouncer(Queue* queue, uint16_t interval_ms = 10) : _queue(queue), _interval_us(interval_ms * 1000) {}
+
+    InterruptDebouncer(const InterruptDebouncer&) = delete;
+    InterruptDebouncer& operator=(const InterruptDebouncer&) = delete;
+
+    // Configures the pin as an input with an edge interrupt. Must be called before begin().
+    DebouncedPin* add(gpio_num_t pin, bool inverted = false, gpio_pull_mode_t pull_mode = GPIO_FLOATING);
+
+    esp_err_t begin();
+
+    // Called on the queue for every debounced change of any pin.
+    CallbackToken on_edge(Callback<DebouncedEdge>::Function func) { return _edge.add(std::move(func)); }
+
+private:
+    static void isr_handler(void* arg);
+    void confirm_pending();
+
+    friend class DebouncedPin;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Span.h"
+#include "esp_err.h"
+
+// Streaming decoder for the LZSS format written by cmake/asset_partition.py --compress.
+// Output is produced in chunks of any size, so a large asset can be decompressed through
+// a small buffer. The decoder keeps the last WINDOW_SIZE bytes of output it needs for
+// back references, so it takes a little over 1 KB of RAM.
+//
+// The stream starts with the decompressed size as a 32 bit little endian integer. It's
+// followed by groups of a flag byte and eight items; bit n of the flag byte, starting at
+// the least significant bit, is set if item n is a literal byte. Otherwise the item is
+// a 16 bit little endian back reference: the upper 10 bits hold the distance minus one
+// and the lower 6 bits the length minus MIN_MATCH.
+class LzssDecoder {
+public:
+    static constexpr uint32_t WINDOW_BITS = 10;
+    static constexpr uint32_t WINDOW_SIZE = 1 << WINDOW_BITS;
+    static constexpr uint32_t LENGTH_BITS = 6;
+    static constexpr uint32_t MIN_MATCH = 3;
+
+private:
+    static constexpr uint32_t WINDOW_MASK = WINDOW_SIZE - 1;
+
+    ByteView _input;
+    size_t _input_pos{};
+    uint32_t _size{};
+    uint32_t _remaining{};
+    uint8_t _flags{};
+    uint8_t _flag_bits{};
+    uint16_t _match_distance{};
+    uint16_t _match_remaining{};
+    uint32_t _window_pos{};
+    uint8_t _window[WINDOW_SIZE];
+
+public:
+    // The input must stay valid while decoding, e.g. a view into an AssetPartition.
+    explicit LzssDecoder(ByteView input);
+
+    // Decompressed size, or zero if the input is too short to hold it.
+    uint32_t get_size() const { return _size; }
+    bool is_done() const { return !_remaining; }
+
+    // Decompresses up to buffer.size() bytes into buffer. length is set to the number of
+    // bytes written, which is only less than the size of the buffer at the end of the
+    // stream. Returns ESP_ERR_INVALID_STATE if the input is corrupt.
+    esp_err_t read(ByteSpan buffer, size_t& length);
+
+private:
+    void emit(uint8_t value, uint8_t* output, size_t& length);
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+#ifdef LV_SIMULATOR
+#include <mutex>
+#else
+#include "freertos/FreeRTOS.h"
+#include "freertos/portmacro.h"
+#endif
+
+struct MemoryPoolStats {
+    const char* name;
+    uint32_t block_size;
+    uint32_t capacity;
+    uint32_t in_use;
+    uint32_t peak;
+    // Number of allocations that found the pool empty.
+    uint32_t failures;
+};
+
+// Pool of fixed size blocks carved out of a single allocation made up front. Allocating
+// and freeing only move a pointer on a free list, so short lived objects that go through
+// a pool don't fragment the heap. All pools register themselves so their statistics can
+// be reported together. Pools are meant to live as long as the application.
+class MemoryPool {
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    const char* _name;
+    size_t _block_size;
+    size_t _capacity;
+    uint8_t* _blocks;
+    FreeBlock* _free{};
+    uint32_t _in_use{};
+    uint32_t _peak{};
+    uint32_t _failures{};
+    MemoryPool* _next_pool{};
+#ifdef LV_SIMULATOR
+    std::mutex _lock;
+#else
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+public:
+    // Blocks are aligned for any fundamental type.
+    MemoryPool(const char* name, size_t block_size, size_t capacity);
+    ~MemoryPool();
+
+    MemoryPool(const MemoryPool&) = delete;
+    MemoryPool& operator=(const MemoryPool&) = delete;
+
+    // Returns nullptr if the pool is exhausted.
+    void* allocate();
+    void deallocate(void* block);
+
+    // Whether block was allocated from this pool. Use this to free objects that may
+    // have fallen back to the heap.
+    bool owns(const void* block) const {
+        return block >= _blocks && block < _blocks + _block_size * _capacity;
+    }
+
+    size_t get_block_size() const { return _block_size; }
+    MemoryPoolStats get_stats();
+
+    // Fills stats with the statistics of up to max_count pools and returns the number of
+    // pools.
+    static size_t get_all_stats(MemoryPoolStats* stats, size_t max_count);
+    static void log_all_stats();
+
+private:
+#ifdef LV_SIMULATOR
+    void lock() { _lock.lock(); }
+    void unlock() { _lock.unlock(); }
+#else
+    void lock() { portENTER_CRITICAL(&_lock); }
+    void unlock() { portEXIT_CRITICAL(&_lock); }
+#endif
+};
+
+// Pool of objects of a single type. When the pool is exhausted, objects are allocated
+// on the heap instead, so callers never have to handle allocation failures.
+template <typename T>
+class ObjectPool {
+    static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned types aren't supported");
+
+    MemoryPool _pool;
+
+public:
+    ObjectPool(const char* name, size_t capacity) : _pool(name, sizeof(T), capacity) {}
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        const auto memory = _pool.allocate();
+        if (!memory) {
+            return new T(std::forward<Args>(args)...);
+        }
+
+        return new (memory) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* object) {
+        if (!object) {
+            return;
+        }
+
+        if (_pool.owns(object)) {
+            object->~T();
+            _pool.deallocate(object);
+        } else {
+            delete object;
+        }
+    }
+
+    MemoryPool& get_pool() { return _pool; }
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "StaticRegistry.h"
+#include "cJSON.h"
+
+enum class MetricType : uint8_t { Counter, Gauge, Histogram };
+
+// Base of the metrics. Metrics are added to a global registry when they're first updated
+// and are never removed, so they must be statically allocated, e.g.
+//
+//   static MetricCounter publish_retries("mqtt.publish_retries");
+//
+// Updating a metric is a relaxed atomic operation that never allocates or blocks, so
+// metrics can be updated from hot paths and log handlers. Values are cumulative since
+// boot; consumers compute rates from consecutive snapshots.
+class Metric : public StaticRegistry<Metric>::Node {
+    const char* _name;
+    MetricType _type;
+
+public:
+    Metric(const Metric&) = delete;
+    Metric& operator=(const Metric&) = delete;
+
+    const char* get_name() const { return _name; }
+    MetricType get_type() const { return _type; }
+
+    // Adds every metric that was updated to the JSON object under its name. Counters and gauges are
+    // added as numbers, histograms as objects.
+    static void add_all_to_json(cJSON* parent);
+
+protected:
+    // Constant initialized, so updates made before static initialization reaches the
+    // metric are kept.
+    constexpr Metric(const char* name, MetricType type) : _name(name), _type(type) {}
+
+    void ensure_added() {
+        if (!is_added()) {
+            add_to_registry();
+        }
+    }
+
+    virtual void add_to_json(cJSON* parent) const = 0;
+
+private:
+    void add_to_registry();
+};
+
+class MetricCounter : public Metric {
+    std::atomic<uint32_t> _value{};
+
+public:
+    explicit constexpr MetricCounter(const char* name) : Metric(name, MetricType::Counter) {}
+
+    void increment(uint32_t amount = 1) {
+        ensure_added();
+        _value.fetch_add(amount, std::memory_order_relaxed);
+    }
+    uint32_t get() const { return _value.load(std::memory_order_relaxed); }
+
+protected:
+    void add_to_json(cJSON* parent) const override;
+};
+
+class MetricGauge : public Metric {
+    std::atomic<float> _value{};
+
+public:
+    explicit constexpr MetricGauge(const char* name) : Metric(name, MetricType::Gauge) {}
+
+    void set(float value) {
+        ensure_added();
+        _value.store(value, std::memory_order_relaxed);
+    }
+    float get() const { return _value.load(std::memory_order_relaxed); }
+
+protected:
+    void add_to_json(cJSON* parent) const override;
+};
+
+class MetricHistogramBase : public Metric {
+    const uint32_t* _bounds;
+    std::atomic<uint32_t>* _counts;
+    size_t _bound_count;
+    std::atomic<uint32_t> _max{};
+
+public:
+    // Counts the value in the first bucket whose bound is at least the value, or in the
+    // overflow bucket after the last bound.
+    void record(uint32_t value);
+    uint32_t get_max() const { return _max.load(std::memory_order_relaxed); }
+
+protected:
+    constexpr MetricHistogramBase(const char* name, const uint32_t* bounds, std::atomic<uint32_t>* counts,
+                                  size_t bound_count)
+        : Metric(name, MetricType::Histogram), _bounds(bounds), _counts(counts), _bound_count(bound_count) {}
+
+    void add_to_json(cJSON* parent) const override;
+};
+
+// Histogram with fixed bucket bounds, which must be in ascending order.
+template <size_t N>
+class MetricHistogram : public MetricHistogramBase {
+    uint32_t _bound_storage[N];
+    // One more than the bounds for the values past the last bound.
+    std::atomic<uint32_t> _count_storage[N + 1]{};
+
+public:
+    constexpr MetricHistogram(const char* name, const uint32_t (&bounds)[N])
+        : MetricHistogramBase(name, _bound_storage, _count_storage, N) {
+        std::copy_n(bounds, N, _bound_storage);
+    }
+};
@@ -1,9 +1,17 @@
 #pragma once
 
-#include <functional>
+#include <optional>
+#include <type_traits>
+#include <utility>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#ifndef CONFIG_ESP_SUPPORT_MUTEX_STATS
+#define CONFIG_ESP_SUPPORT_MUTEX_STATS 0
+#endif
 
 class Mutex;
 
@@ -22,8 +30,24 @@ public:
     friend class Mutex;
 };
 
+// Only collected with CONFIG_ESP_SUPPORT_MUTEX_STATS.
+struct MutexStats {
+    uint32_t acquired;
+    // Number of times the mutex was held by another task when we tried to take it.
+    uint32_t contended;
+    // 64 bits, so it doesn't wrap after 71 minutes of waiting.
+    uint64_t wait_total_us;
+    uint32_t wait_max_us;
+    // Task that held the mutex the last time we had to wait for it.
+    TaskHandle_t last_holder;
+};
+
 class Mutex {
     SemaphoreHandle_t _lock;
+#if CONFIG_ESP_SUPPORT_MUTEX_STATS
+    // Only updated with the lock held.
+    MutexStats _stats{};
+#endif
 
 public:
     Mutex();
@@ -31,18 +55,44 @@ public:
 
     [[nodiscard]] MutexLock take(TickType_t xTicksToWait = portMAX_DELAY);
 
-    template <typename Result>
-    Result with(std::function<Result()> func, TickType_t xTicksToWait = portMAX_DELAY) {
+    // Runs func with the lock held and returns its result. Aborts if the lock can't
+    // be taken in time.
+    template <typename F>
+    std::invoke_result_t<F&> with(F&& func, TickType_t xTicksToWait = portMAX_DELAY) {
         auto lock = take(xTicksToWait);
         return func();
     }
 
-    void with(std::function<void()> func, TickType_t xTicksToWait = portMAX_DELAY) {
-        auto lock = take(xTicksToWait);
-        func();
+    // Runs func with the lock held if the lock can be taken in time. Returns the result
+    // of func in an optional, or whether func ran if it returns void.
+    template <typename F>
+    auto try_with(F&& func, TickType_t xTicksToWait = 0) {
+        using Result = std::invoke_result_t<F&>;
+
+        const auto taken = try_take(xTicksToWait);
+
+        if constexpr (std::is_void_v<Result>) {
+            if (taken) {
+                MutexLock lock(this);
+                func();
+            }
+            return taken;
+        } else {
+            if (!taken) {
+                return std::optional<Result>();
+            }
+
+            MutexLock lock(this);
+            return std::optional<Result>(func());
+        }
     }
 
+#if CONFIG_ESP_SUPPORT_MUTEX_STATS
+    MutexStats get_stats();
+#endif
+
 private:
+    bool try_take(TickType_t xTicksToWait);
     void give();
 
     friend class MutexLock;
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <array>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "error.h"
 #include "nvs_flash.h"
 
 esp_err_t nvs_get_i1(nvs_handle_t c_handle, const char* key, bool* out_value);
@@ -8,32 +14,127 @@ esp_err_t nvs_set_i1(nvs_handle_t handle, const char* key, bool value);
 esp_err_t nvs_get_f32(nvs_handle_t c_handle, const char* key, float* out_value);
 esp_err_t nvs_set_f32(nvs_handle_t handle, const char* key, float value);
 
-class NVSProperty {
+// Variable length binary data.
+using NVSBlob = std::vector<uint8_t>;
+
+// Overloads for all types supported by NVSProperty. Bools are stored as i8 and floats as
+// u32 so existing data stays readable. Fixed size arrays are stored as blobs of exactly
+// their size.
+
+#define nvs_value_DECLARE(type, typename_lc)                                            \
+    inline esp_err_t nvs_get_value(nvs_handle_t handle, const char* key, type& value) { \
+        return nvs_get_##typename_lc(handle, key, &value);                              \
+    }                                                                                   \
+    inline esp_err_t nvs_set_value(nvs_handle_t handle, const char* key, type value) {  \
+        return nvs_set_##typename_lc(handle, key, value);                               \
+    }
+
+nvs_value_DECLARE(bool, i1);
+nvs_value_DECLARE(int8_t, i8);
+nvs_value_DECLARE(uint8_t, u8);
+nvs_value_DECLARE(int16_t, i16);
+nvs_value_DECLARE(uint16_t, u16);
+nvs_value_DECLARE(int32_t, i32);
+nvs_value_DECLARE(uint32_t, u32);
+nvs_value_DECLARE(int64_t, i64);
+nvs_value_DECLARE(uint64_t, u64);
+nvs_value_DECLARE(float, f32);
+
+#undef nvs_value_DECLARE
+
+esp_err_t nvs_get_value(nvs_handle_t handle, const char* key, std::string& value);
+esp_err_t nvs_set_value(nvs_handle_t handle, const char* key, const std::string& value);
+
+esp_err_t nvs_get_value(nvs_handle_t handle, const char* key, NVSBlob& value);
+esp_err_t nvs_set_value(nvs_handle_t handle, const char* key, const NVSBlob& value);
+
+template <typename T, size_t N>
+esp_err_t nvs_get_value(nvs_handle_t handle, const char* key, std::array<T, N>& value) {
+    static_assert(std::is_trivially_copyable_v<T>, "Array elements must be trivially copyable");
+
+    auto length = sizeof(value);
+    const auto err = nvs_get_blob(handle, key, value.data(), &length);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    return length == sizeof(value) ? ESP_OK : ESP_ERR_NVS_INVALID_LENGTH;
+}
+
+template <typename T, size_t N>
+esp_err_t nvs_set_value(nvs_handle_t handle, const char* key, const std::array<T, N>& value) {
+    static_assert(std::is_trivially_copyable_v<T>, "Array elements must be trivially copyable");
+
+    return nvs_set_blob(handle, key, value.data(), sizeof(value));
+}
+
+class NVSPropertyBase {
     const char* _key;
 
 protected:
-    NVSProperty(const char* key) : _key(key) {}
+    // Only takes string literals, so the length of the key is checked at compile time.
+    template <size_t N>
+    constexpr NVSPropertyBase(const char (&key)[N]) : _key(key) {
+        static_assert(N > 1, "NVS keys can't be empty");
+        static_assert(N <= NVS_KEY_NAME_MAX_SIZE, "NVS keys are at most 15 characters");
+    }
 
 public:
-    const char* get_key() { return _key; }
+    const char* get_key() const { return _key; }
 };
 
-#define NVSProperty_DECLARE(type, typename_uc)                          \
-    class NVSProperty##typename_uc : public NVSProperty {               \
-    public:                                                             \
-        NVSProperty##typename_uc(const char* key) : NVSProperty(key) {} \
-                                                                        \
-        type get(nvs_handle_t handle, type default_value);              \
-        void set(nvs_handle_t handle, type value);                      \
+template <typename T>
+class NVSProperty : public NVSPropertyBase {
+    static constexpr bool is_string = std::is_same_v<T, std::string>;
+    static constexpr bool is_blob = std::is_same_v<T, NVSBlob>;
+
+public:
+    template <size_t N>
+    constexpr NVSProperty(const char (&key)[N]) : NVSPropertyBase(key) {}
+
+    // Reads into the caller's value. Strings and blobs reuse the capacity of value; if
+    // that's big enough, nothing is allocated and the entry is only read once.
+    esp_err_t read(nvs_handle_t handle, T& value) const { return nvs_get_value(handle, get_key(), value); }
+
+    esp_err_t write(nvs_handle_t handle, const T& value) const { return nvs_set_value(handle, get_key(), value); }
+
+    // Returns default_value if the key doesn't exist or can't be read.
+    T get(nvs_handle_t handle, T default_value) const {
+        T value;
+        if (read(handle, value) != ESP_OK) {
+            return default_value;
+        }
+        return value;
+    }
+
+    void set(nvs_handle_t handle, const T& value) const { ESP_ERROR_CHECK(write(handle, value)); }
+
+    // Reads a string into a caller provided buffer. length is the size of the buffer on
+    // input and the length including the terminating null character on output.
+    esp_err_t read(nvs_handle_t handle, char* buffer, size_t& length) const
+        requires is_string
+    {
+        return nvs_get_str(handle, get_key(), buffer, &length);
     }
 
-NVSProperty_DECLARE(bool, I1);
-NVSProperty_DECLARE(int8_t, I8);
-NVSProperty_DECLARE(uint8_t, U8);
-NVSProperty_DECLARE(int16_t, I16);
-NVSProperty_DECLARE(uint16_t, U16);
-NVSProperty_DECLARE(int32_t, I32);
-NVSProperty_DECLARE(uint32_t, U32);
-NVSProperty_DECLARE(float, F32);
+    // Reads a blob into a caller provided buffer. length is the size of the buffer on
+    // input and the size of the blob on output.
+    esp_err_t read(nvs_handle_t handle, void* buffer, size_t& length) const
+        requires is_blob
+    {
+        return nvs_get_blob(handle, get_key(), buffer, &length);
+    }
+};
 
-#undef NVSProperty_DECLARE
+using NVSPropertyI1 = NVSProperty<bool>;
+using NVSPropertyI8 = NVSProperty<int8_t>;
+using NVSPropertyU8 = NVSProperty<uint8_t>;
+using NVSPropertyI16 = NVSProperty<int16_t>;
+using NVSPropertyU16 = NVSProperty<uint16_t>;
+using NVSPropertyI32 = NVSProperty<int32_t>;
+using NVSPropertyU32 = NVSProperty<uint32_t>;
+using NVSPropertyI64 = NVSProperty<int64_t>;
+using NVSPropertyU64 = NVSProperty<uint64_t>;
+using NVSPropertyF32 = NVSProperty<float>;
+using NVSPropertyString = NVSProperty<std::string>;
+using NVSPropertyBlob = NVSProperty<NVSBlob>;
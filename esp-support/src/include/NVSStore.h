@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+
+#include "Mutex.h"
+#include "NVSProperty.h"
+#include "Queue.h"
+#include "sdkconfig.h"
+
+#ifndef CONFIG_ESP_SUPPORT_NVS_COMMIT_DELAY_MS
+#define CONFIG_ESP_SUPPORT_NVS_COMMIT_DELAY_MS 5000
+#endif
+
+class NVSStore;
+
+class NVSCachedPropertyBase {
+    NVSStore* _store;
+    NVSCachedPropertyBase* _next;
+    std::atomic<bool> _dirty{};
+    // Written by the running flush, but not committed yet. Guarded by the flush mutex.
+    bool _uncommitted{};
+
+protected:
+    NVSCachedPropertyBase(NVSStore* store);
+
+    NVSCachedPropertyBase(const NVSCachedPropertyBase&) = delete;
+    NVSCachedPropertyBase& operator=(const NVSCachedPropertyBase&) = delete;
+
+    void mark_dirty();
+
+    virtual void load(nvs_handle_t handle) = 0;
+    virtual esp_err_t store(nvs_handle_t handle) = 0;
+
+public:
+    virtual ~NVSCachedPropertyBase() = default;
+
+    virtual const char* get_key() const = 0;
+
+    bool is_dirty() const { return _dirty.load(std::memory_order_relaxed); }
+
+    friend class NVSStore;
+};
+
+// Property whose value lives in RAM. The value is read from NVS by NVSStore::load()
+// and written back by NVSStore::flush() if it changed. get() and set() never touch
+// flash and can be called from any task.
+template <typename T>
+class NVSCachedProperty : public NVSCachedPropertyBase {
+    NVSProperty<T> _property;
+    std::atomic<T> _value;
+
+public:
+    template <size_t N>
+    NVSCachedProperty(NVSStore* store, const char (&key)[N], T default_value = {})
+        : NVSCachedPropertyBase(store), _property(key), _value(default_value) {}
+
+    const char* get_key() const override { return _property.get_key(); }
+
+    T get() const { return _value.load(std::memory_order_relaxed); }
+
+    void set(T value) {
+        if (_value.exchange(value, std::memory_order_relaxed) != value) {
+            mark_dirty();
+        }
+    }
+
+protected:
+    void load(nvs_handle_t handle) override { _value = _property.get(handle, _value.load()); }
+    esp_err_t store(nvs_handle_t handle) override { return _property.write(handle, _value.load()); }
+};
+
+// Write-back cache for the properties of a single NVS namespace. Changed properties
+// are written under a single handle and committed at once. If a queue is provided,
+// a flush is scheduled commit_delay_ms after the first change, so that a burst of
+// changes costs a single commit. Without a queue, the owner calls flush() itself.
+class NVSStore {
+    const char* _namespace;
+    Queue* _queue;
+    uint32_t _commit_delay_ms;
+    // Properties register themselves on construction. This must be done before load().
+    NVSCachedPropertyBase* _properties{};
+    std::atomic<bool> _flush_scheduled{};
+    Mutex _flush_mutex;
+
+public:
+    NVSStore(const char* name_space, Queue* queue = nullptr,
+             uint32_t commit_delay_ms = CONFIG_ESP_SUPPORT_NVS_COMMIT_DELAY_MS)
+        : _namespace(name_space), _queue(queue), _commit_delay_ms(commit_delay_ms) {}
+
+    NVSStore(const NVSStore&) = delete;
+    NVSStore& operator=(const NVSStore&) = delete;
+
+    // Reads all properties. Properties missing from NVS keep their default value.
+    esp_err_t load();
+
+    // Writes all changed properties and commits them. Properties that fail to be written
+    // or committed stay dirty and another flush is scheduled, so nothing is lost when
+    // e.g. NVS is full for a while. Without a queue, call flush() again later.
+    esp_err_t flush();
+
+    bool is_dirty() const;
+
+private:
+    void add(NVSCachedPropertyBase* property);
+    void schedule_flush();
+
+    friend class NVSCachedPropertyBase;
+};
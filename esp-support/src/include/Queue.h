@@ -1,34 +1,194 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
-#include <vector>
 
-#include "freertos/FreeRTOS.h"
+#include "InlineFunction.h"
+#include "TimerScheduler.h"
 
 #ifdef LV_SIMULATOR
+#include <condition_variable>
 #include <deque>
+#include <mutex>
+#include <thread>
 #else
+#include "Signal.h"
+#include "freertos/FreeRTOS.h"
 #include "freertos/portmacro.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#endif
+
+#ifndef CONFIG_ESP_SUPPORT_QUEUE_LENGTH
+#define CONFIG_ESP_SUPPORT_QUEUE_LENGTH 32
 #endif
+#ifndef CONFIG_ESP_SUPPORT_QUEUE_POOL_SIZE
+// Both lanes filled up plus every timer.
+#define CONFIG_ESP_SUPPORT_QUEUE_POOL_SIZE (2 * CONFIG_ESP_SUPPORT_QUEUE_LENGTH + CONFIG_ESP_SUPPORT_QUEUE_MAX_TIMERS)
+#endif
+#ifndef CONFIG_ESP_SUPPORT_QUEUE_TASK_INLINE_SIZE
+#define CONFIG_ESP_SUPPORT_QUEUE_TASK_INLINE_SIZE 32
+#endif
+#ifndef CONFIG_ESP_SUPPORT_QUEUE_INSTRUMENTATION
+#define CONFIG_ESP_SUPPORT_QUEUE_INSTRUMENTATION 0
+#endif
+
+enum class QueuePriority {
+    // Latency sensitive work like button presses and commands. This is the default.
+    Interactive,
+    // Long running work like publishing discovery information. Bulk tasks only
+    // run when there is no interactive work pending.
+    Bulk,
+};
+
+constexpr size_t QUEUE_PRIORITY_COUNT = 2;
+
+// Bucket i of a histogram counts durations below 128 << i microseconds that didn't
+// fit an earlier bucket. The last bucket counts everything that's left, i.e. 131 ms
+// and up.
+constexpr size_t QUEUE_HISTOGRAM_BUCKETS = 12;
+constexpr uint32_t QUEUE_HISTOGRAM_FIRST_BUCKET_US = 128;
+
+struct QueueLaneStats {
+    uint32_t depth;
+    // High-water mark of the FreeRTOS queue backing the lane.
+    uint32_t depth_peak;
+    uint32_t processed;
+    // Time between enqueueing a task and it starting to run.
+    uint32_t latency_avg_us;
+    uint32_t latency_max_us;
+    // The below are only collected with CONFIG_ESP_SUPPORT_QUEUE_INSTRUMENTATION.
+    uint32_t latency_histogram[QUEUE_HISTOGRAM_BUCKETS];
+    uint32_t run_time_avg_us;
+    uint32_t run_time_max_us;
+    uint32_t run_time_histogram[QUEUE_HISTOGRAM_BUCKETS];
+    uint32_t slow_tasks;
+};
+
+struct QueueStats {
+    QueueLaneStats lanes[QUEUE_PRIORITY_COUNT];
+    uint32_t pool_size;
+    uint32_t pool_in_use;
+    uint32_t pool_peak;
+    // Number of tasks that found the pool empty and got a heap allocated slot instead.
+    uint32_t pool_exhausted;
+    // Number of tasks whose captures didn't fit the inline storage of a slot.
+    uint32_t oversized;
+    // Call site that enqueued the last slow task and how long it ran. Resolve the
+    // address with addr2line.
+    void* last_slow_task_caller;
+    uint32_t last_slow_task_run_time_us;
+};
 
 class Queue {
+public:
+    using Task = InlineFunction<void(), CONFIG_ESP_SUPPORT_QUEUE_TASK_INLINE_SIZE>;
+
+private:
 #ifndef LV_SIMULATOR
-    QueueHandle_t _queue;
-    std::vector<std::pair<int64_t, std::function<void()>>> _delayed_tasks;
-    portMUX_TYPE _delayed_tasks_lock = portMUX_INITIALIZER_UNLOCKED;
+    struct Slot {
+        Task task;
+        Slot* next;
+        int64_t enqueued_at;
+#if CONFIG_ESP_SUPPORT_QUEUE_INSTRUMENTATION
+        // Return address of the enqueue call. Timer trampolines leave this empty;
+        // the timer task they run is measured instead.
+        void* caller;
+#endif
+    };
+
+    struct Lane {
+        QueueHandle_t queue;
+        std::atomic<uint32_t> depth_peak;
+        std::atomic<uint32_t> processed;
+        std::atomic<uint64_t> latency_total_us;
+        std::atomic<uint32_t> latency_max_us;
+#if CONFIG_ESP_SUPPORT_QUEUE_INSTRUMENTATION
+        std::atomic<uint32_t> latency_histogram[QUEUE_HISTOGRAM_BUCKETS];
+        std::atomic<uint64_t> run_time_total_us;
+        std::atomic<uint32_t> run_time_max_us;
+        std::atomic<uint32_t> run_time_histogram[QUEUE_HISTOGRAM_BUCKETS];
+        std::atomic<uint32_t> run_time_count;
+        std::atomic<uint32_t> slow_tasks;
+#endif
+    };
+
+    Lane _lanes[QUEUE_PRIORITY_COUNT]{};
+    Slot _slots[CONFIG_ESP_SUPPORT_QUEUE_POOL_SIZE];
+    Slot* _free_slots{};
+    portMUX_TYPE _slots_lock = portMUX_INITIALIZER_UNLOCKED;
+    uint32_t _slots_in_use{};
+    uint32_t _slots_peak{};
+    std::atomic<uint32_t> _pool_exhausted{};
+    std::atomic<uint32_t> _oversized{};
+    TimerScheduler _timers;
+    Signal _wake;
+    std::atomic<int64_t> _wake_at{INT64_MAX};
+    std::atomic<TaskHandle_t> _process_task{};
+#if CONFIG_ESP_SUPPORT_QUEUE_INSTRUMENTATION
+    std::atomic<void*> _last_slow_task_caller{};
+    std::atomic<uint32_t> _last_slow_task_run_time_us{};
+#endif
 #else
-    std::deque<function<void()>> _queue;
+    struct Entry {
+        Task task;
+        int64_t enqueued_at;
+    };
+
+    struct Lane {
+        std::deque<Entry> entries;
+        uint32_t depth_peak;
+        uint32_t processed;
+        uint64_t latency_total_us;
+        uint32_t latency_max_us;
+    };
+
+    // Guards everything below, except for the timers which have their own lock.
+    std::mutex _mutex;
+    std::condition_variable _not_full;
+    std::condition_variable _wake;
+    Lane _lanes[QUEUE_PRIORITY_COUNT]{};
+    bool _signaled{};
+    int64_t _wake_at{INT64_MAX};
+    std::thread::id _process_thread;
+    std::atomic<uint32_t> _oversized{};
+    TimerScheduler _timers;
 #endif
 
 public:
     Queue();
 
-    void enqueue(const std::function<void()>& task, bool wait = true);
-#ifndef LV_SIMULATOR
-    void enqueue_delayed(const std::function<void()>& task, uint32_t delay_ms);
-#endif
+    void enqueue(Task task, bool wait = true);
+    void enqueue(Task task, QueuePriority priority, bool wait = true);
+    // Return an invalid handle, and drop the task, if all CONFIG_ESP_SUPPORT_QUEUE_MAX_TIMERS
+    // timers are in use.
+    TimerHandle enqueue_delayed(Task task, uint32_t delay_ms);
+    TimerHandle enqueue_periodic(Task task, uint32_t interval_ms);
+    // Returns whether the timer was still pending. Cancelling a timer whose task is
+    // already queued prevents it from running.
+    bool cancel(TimerHandle handle);
     void process();
+    // Blocks until a task is enqueued, a delayed task is due, a wake requested through
+    // wake_after() is due or max_wait_ms has passed, and then processes the queue. Use
+    // this instead of polling process() so the CPU can idle.
+    void wait_and_process(uint32_t max_wait_ms = UINT32_MAX);
+    // Limits the next wait of wait_and_process() to delay_ms. A request only applies to a
+    // single wait; components that need periodic service should request a new wake every
+    // time they're processed. Pass UINT32_MAX to not request a wake.
+    void wake_after(uint32_t delay_ms);
+    QueueStats get_stats();
 
 private:
     void handled_delayed_enqueues();
+    bool run_next(QueuePriority priority);
+    TimerHandle schedule(Task task, uint32_t delay_ms, uint32_t period_ms, void* caller);
+    void run_timer(TimerHandle handle);
+    bool has_pending();
+    void notify();
+#ifndef LV_SIMULATOR
+    Slot* acquire_slot();
+    void release_slot(Slot* slot);
+    void enqueue_from(Task task, QueuePriority priority, bool wait, void* caller);
+    void execute(Lane& lane, Slot* slot);
+#endif
 };
@@ -0,0 +1,309 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Called by a producer when the number of items in a ring buffer reaches the watermark.
+// It's called from the context of the producer, so it must be ISR safe if an ISR pushes,
+// e.g. Signal::signal_from_isr().
+using RingBufferWatermarkCallback = void (*)(void* arg);
+
+namespace detail {
+
+class RingBufferWatermark {
+    size_t _level{SIZE_MAX};
+    RingBufferWatermarkCallback _callback{};
+    void* _arg{};
+    // Set once the watermark was reported, until the consumer drains below it again.
+    std::atomic<bool> _reached{};
+
+public:
+    // Not thread-safe; call before producers start.
+    void set_watermark(size_t level, RingBufferWatermarkCallback callback, void* arg) {
+        _level = level;
+        _callback = callback;
+        _arg = arg;
+        _reached = false;
+    }
+
+protected:
+    void pushed(size_t size) {
+        if (size >= _level && !_reached.exchange(true)) {
+            _callback(_arg);
+        }
+    }
+
+    void popped(size_t size) {
+        if (size < _level && _reached.load(std::memory_order_relaxed)) {
+            _reached = false;
+        }
+    }
+};
+
+}  // namespace detail
+
+// Lock-free fixed capacity ring buffer for a single producer and a single consumer.
+// Either side may be an ISR. Neither side ever blocks or allocates.
+//
+// With OverwriteOldest, a push into a full buffer drops the oldest items instead of
+// failing. The consumer then copies items optimistically and retries if the producer
+// dropped them while they were being copied. Since the producer may be writing an item
+// the consumer is copying, items are stored as words that are loaded and stored
+// atomically, so a torn copy is discarded instead of being a data race.
+template <typename T, size_t Capacity, bool OverwriteOldest = false>
+class SpscRingBuffer : public detail::RingBufferWatermark {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "Items must be trivially copyable");
+
+    static constexpr uint32_t MASK = Capacity - 1;
+
+    using Word = std::conditional_t<sizeof(T) % sizeof(uint32_t) == 0, uint32_t, uint8_t>;
+    static constexpr size_t WORDS = sizeof(T) / sizeof(Word);
+
+    struct AtomicItem {
+        std::atomic<Word> words[WORDS];
+    };
+
+    std::conditional_t<OverwriteOldest, AtomicItem, T> _items[Capacity];
+    // Free running indices; only their difference is reduced modulo the capacity. The
+    // head is only written by the producer; the tail by the consumer, and by the producer
+    // when overwriting.
+    std::atomic<uint32_t> _head{};
+    std::atomic<uint32_t> _tail{};
+    std::atomic<uint32_t> _overwritten{};
+
+public:
+    static constexpr size_t capacity() { return Capacity; }
+
+    bool push(const T& item) { return push(&item, 1) == 1; }
+
+    // Returns the number of items pushed. Without OverwriteOldest, that's less than
+    // count if the buffer fills up.
+    size_t push(const T* items, size_t count) {
+        const auto head = _head.load(std::memory_order_relaxed);
+        auto tail = _tail.load(std::memory_order_acquire);
+
+        if constexpr (OverwriteOldest) {
+            const auto pushed = count;
+
+            if (count > Capacity) {
+                // Only the newest items survive anyway.
+                _overwritten.fetch_add(uint32_t(count - Capacity), std::memory_order_relaxed);
+                items += count - Capacity;
+                count = Capacity;
+            }
+
+            while (head - tail + count > Capacity) {
+                const auto drop = uint32_t(head - tail + count - Capacity);
+                if (_tail.compare_exchange_weak(tail, tail + drop, std::memory_order_acq_rel)) {
+                    _overwritten.fetch_add(drop, std::memory_order_relaxed);
+                    tail += drop;
+                    break;
+                }
+            }
+
+            write(head, items, count);
+            pushed_to(head, tail, count);
+
+            return pushed;
+        } else {
+            count = std::min(count, size_t(Capacity - (head - tail)));
+
+            write(head, items, count);
+            pushed_to(head, tail, count);
+
+            return count;
+        }
+    }
+
+    bool pop(T& item) { return pop(&item, 1) == 1; }
+
+    // Returns the number of items popped, up to max_count.
+    size_t pop(T* items, size_t max_count) {
+        auto tail = _tail.load(std::memory_order_relaxed);
+
+        while (true) {
+            const auto head = _head.load(std::memory_order_acquire);
+            const auto count = std::min({max_count, size_t(head - tail), Capacity});
+
+            for (size_t i = 0; i < count; i++) {
+                read(tail + i, items[i]);
+            }
+
+            if constexpr (OverwriteOldest) {
+                // If the producer moved the tail, what we copied may have been
+                // overwritten. Retry from the new tail.
+                if (!_tail.compare_exchange_weak(tail, uint32_t(tail + count), std::memory_order_acq_rel)) {
+                    continue;
+                }
+            } else {
+                _tail.store(uint32_t(tail + count), std::memory_order_release);
+            }
+
+            popped(head - tail - count);
+
+            return count;
+        }
+    }
+
+    size_t size() const {
+        // Read the tail first so it can't overtake the head we compare it with.
+        const auto tail = _tail.load(std::memory_order_acquire);
+        return _head.load(std::memory_order_acquire) - tail;
+    }
+    bool empty() const { return size() == 0; }
+
+    // Number of items dropped to make room for new ones.
+    uint32_t get_overwritten() const { return _overwritten.load(std::memory_order_relaxed); }
+
+private:
+    void write(uint32_t head, const T* items, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            auto& slot = _items[(head + i) & MASK];
+
+            if constexpr (OverwriteOldest) {
+                Word words[WORDS];
+                memcpy(words, &items[i], sizeof(T));
+                // Release, so a consumer that copies any of these words also sees the
+                // tail that was moved to drop the item before.
+                for (size_t j = 0; j < WORDS; j++) {
+                    slot.words[j].store(words[j], std::memory_order_release);
+                }
+            } else {
+                slot = items[i];
+            }
+        }
+    }
+
+    void read(uint32_t index, T& item) const {
+        const auto& slot = _items[index & MASK];
+
+        if constexpr (OverwriteOldest) {
+            Word words[WORDS];
+            for (size_t j = 0; j < WORDS; j++) {
+                words[j] = slot.words[j].load(std::memory_order_acquire);
+            }
+            memcpy(&item, words, sizeof(T));
+        } else {
+            item = slot;
+        }
+    }
+
+    void pushed_to(uint32_t head, uint32_t tail, size_t count) {
+        _head.store(uint32_t(head + count), std::memory_order_release);
+
+        pushed(head + count - tail);
+    }
+};
+
+// Lock-free fixed capacity ring buffer for any number of producers and a single consumer.
+// Producers claim a slot with a compare and swap and publish it through a per-slot
+// sequence number, so ISRs can push as well. A producer that's interrupted between
+// claiming and publishing a slot holds up the consumer at that slot until it resumes.
+template <typename T, size_t Capacity>
+class MpscRingBuffer : public detail::RingBufferWatermark {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "Items must be trivially copyable");
+
+    static constexpr uint32_t MASK = Capacity - 1;
+
+    struct Slot {
+        // Equals the index a producer may claim the slot at, plus one once the item
+        // is published.
+        std::atomic<uint32_t> sequence;
+        T item;
+    };
+
+    Slot _slots[Capacity];
+    std::atomic<uint32_t> _head{};
+    // Only written by the consumer. Atomic so size() can be called from anywhere.
+    std::atomic<uint32_t> _tail{};
+
+public:
+    MpscRingBuffer() {
+        for (uint32_t i = 0; i < Capacity; i++) {
+            _slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+    // Returns false if the buffer is full.
+    bool push(const T& item) {
+        auto head = _head.load(std::memory_order_relaxed);
+        Slot* slot;
+
+        while (true) {
+            slot = &_slots[head & MASK];
+
+            const auto diff = int32_t(slot->sequence.load(std::memory_order_acquire) - head);
+            if (diff == 0) {
+                if (_head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // The consumer hasn't freed the slot yet.
+                return false;
+            } else {
+                // Another producer claimed the slot.
+                head = _head.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->item = item;
+        slot->sequence.store(head + 1, std::memory_order_release);
+
+        pushed(head + 1 - _tail.load(std::memory_order_relaxed));
+
+        return true;
+    }
+
+    // Items of a batch are claimed one by one, so they may interleave with items of
+    // other producers. Returns the number of items pushed.
+    size_t push(const T* items, size_t count) {
+        size_t pushed = 0;
+        while (pushed < count && push(items[pushed])) {
+            pushed++;
+        }
+        return pushed;
+    }
+
+    bool pop(T& item) { return pop(&item, 1) == 1; }
+
+    // Returns the number of items popped, up to max_count. Stops at the first slot that
+    // isn't published yet.
+    size_t pop(T* items, size_t max_count) {
+        auto tail = _tail.load(std::memory_order_relaxed);
+        size_t count = 0;
+
+        while (count < max_count) {
+            auto& slot = _slots[tail & MASK];
+            if (slot.sequence.load(std::memory_order_acquire) != tail + 1) {
+                break;
+            }
+
+            items[count++] = slot.item;
+            // Free the slot for the producer that wraps around to it.
+            slot.sequence.store(tail + Capacity, std::memory_order_release);
+            tail++;
+        }
+
+        if (count) {
+            _tail.store(tail, std::memory_order_relaxed);
+
+            popped(size());
+        }
+
+        return count;
+    }
+
+    size_t size() const {
+        const auto tail = _tail.load(std::memory_order_acquire);
+        return _head.load(std::memory_order_acquire) - tail;
+    }
+    bool empty() const { return size() == 0; }
+};
@@ -4,6 +4,8 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 
+// Wakes a single waiter. Signals given while nobody waits collapse into one. Use
+// EventSignal to tell different reasons apart.
 class Signal {
     SemaphoreHandle_t _sem;
 
@@ -17,5 +19,11 @@ public:
 
     void signal() { xSemaphoreGive(_sem); }
 
+    void signal_from_isr() {
+        BaseType_t higher_priority_task_woken = pdFALSE;
+        xSemaphoreGiveFromISR(_sem, &higher_priority_task_woken);
+        portYIELD_FROM_ISR(higher_priority_task_woken);
+    }
+
     bool wait(TickType_t timeout = portMAX_DELAY) { return xSemaphoreTake(_sem, timeout) == pdTRUE; }
 };
\ No newline at end of file
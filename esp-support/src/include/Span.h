@@ -1,13 +1,92 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "error.h"
+
+// Non-owning view over a contiguous range of T. Indexing and slicing are bounds checked.
+// Use Span<const T> for read-only views; a Span<T> converts to it implicitly.
 template <typename T>
 class Span {
-    T* _buffer;
-    size_t _len;
+    T* _buffer{};
+    size_t _len{};
 
 public:
-    Span(T* buffer, size_t len) : _buffer(buffer), _len(len) {}
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using iterator = T*;
+
+    constexpr Span() = default;
+    constexpr Span(T* buffer, size_t len) : _buffer(buffer), _len(len) {}
+
+    template <size_t N>
+    constexpr Span(T (&buffer)[N]) : _buffer(buffer), _len(N) {}
+
+    template <typename U>
+        requires(std::is_convertible_v<U (*)[], T (*)[]> && !std::is_same_v<U, T>)
+    constexpr Span(const Span<U>& other) : _buffer(other.data()), _len(other.size()) {}
+
+    T* buffer() const { return _buffer; }
+    size_t len() const { return _len; }
+
+    T* data() const { return _buffer; }
+    size_t size() const { return _len; }
+    bool empty() const { return _len == 0; }
+
+    iterator begin() const { return _buffer; }
+    iterator end() const { return _buffer + _len; }
+
+    T& operator[](size_t index) const {
+        ESP_ASSERT_CHECK(index < _len);
 
-    T* buffer() { return _buffer; }
-    size_t len() { return _len; }
+        return _buffer[index];
+    }
+
+    // Elements from offset up to count elements, or up to the end if count is omitted.
+    Span subspan(size_t offset, size_t count = SIZE_MAX) const {
+        ESP_ASSERT_CHECK(offset <= _len);
+
+        return {_buffer + offset, count == SIZE_MAX ? _len - offset : checked_count(offset, count)};
+    }
+
+    Span first(size_t count) const { return {_buffer, checked_count(0, count)}; }
+    Span last(size_t count) const { return {_buffer + _len - checked_count(0, count), count}; }
+
+    bool starts_with(Span<const T> prefix) const {
+        return prefix.size() <= _len && Span<const T>(_buffer, prefix.size()) == prefix;
+    }
+
+    friend bool operator==(const Span& a, const Span& b) {
+        if (a._len != b._len) {
+            return false;
+        }
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            return a._len == 0 || memcmp(a._buffer, b._buffer, a._len * sizeof(T)) == 0;
+        } else {
+            for (size_t i = 0; i < a._len; i++) {
+                if (!(a._buffer[i] == b._buffer[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+private:
+    size_t checked_count(size_t offset, size_t count) const {
+        ESP_ASSERT_CHECK(count <= _len - offset);
+
+        return count;
+    }
 };
+
+using ByteSpan = Span<uint8_t>;
+using ByteView = Span<const uint8_t>;
+
+inline ByteView as_bytes(std::string_view value) { return {(const uint8_t*)value.data(), value.size()}; }
+inline ByteSpan as_writable_bytes(std::string& value) { return {(uint8_t*)value.data(), value.size()}; }
+inline std::string_view as_string_view(ByteView value) { return {(const char*)value.data(), value.size()}; }
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+
+// Intrusive list of statically allocated objects, like metrics and heap accounts. Objects
+// derive from StaticRegistry<T>::Node and are only ever added, so the list can be walked
+// without a lock.
+//
+// Objects add themselves when they're first updated rather than in their constructor.
+// That keeps the constructor constexpr, so the object is constant initialized and an
+// update made before dynamic initialization reaches it, e.g. from the constructor of a
+// static object in another file, isn't reset by registering it.
+template <typename T>
+class StaticRegistry {
+public:
+    class Node {
+        T* _next{};
+        std::atomic<bool> _added{};
+
+        friend class StaticRegistry;
+
+    public:
+        constexpr Node() = default;
+
+        Node(const Node&) = delete;
+        Node& operator=(const Node&) = delete;
+
+        bool is_added() const { return _added.load(std::memory_order_relaxed); }
+    };
+
+    constexpr StaticRegistry() = default;
+
+    // Adds the object, unless it was added already.
+    void add(T* object) {
+        Node* node = object;
+        if (node->_added.exchange(true, std::memory_order_relaxed)) {
+            return;
+        }
+
+        auto next = _head.load(std::memory_order_relaxed);
+        do {
+            node->_next = next;
+        } while (!_head.compare_exchange_weak(next, object, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    template <typename F>
+    void for_each(F func) const {
+        for (auto object = _head.load(std::memory_order_acquire); object; object = ((Node*)object)->_next) {
+            func(object);
+        }
+    }
+
+private:
+    std::atomic<T*> _head{};
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "error.h"
+#include "strformat.h"
+
+// Builds a string in a fixed size buffer on the stack and only moves to the heap when
+// that overflows. Use this instead of strformat or concatenating std::strings when the
+// result is only needed temporarily, e.g. for MQTT topics.
+template <size_t Capacity = 128>
+class StringBuilder {
+    char _buffer[Capacity];
+    char* _data{_buffer};
+    // Excludes the null terminator.
+    size_t _capacity{Capacity - 1};
+    size_t _length{};
+
+public:
+    StringBuilder() { _buffer[0] = '\0'; }
+
+    template <typename... Args>
+    explicit StringBuilder(const char* fmt, Args&&... args) : StringBuilder() {
+        appendf(fmt, std::forward<Args>(args)...);
+    }
+
+    StringBuilder(const StringBuilder&) = delete;
+    StringBuilder& operator=(const StringBuilder&) = delete;
+
+    ~StringBuilder() {
+        if (_data != _buffer) {
+            delete[] _data;
+        }
+    }
+
+    StringBuilder& append(const char* value, size_t length) {
+        reserve(_length + length);
+
+        memcpy(_data + _length, value, length);
+        _length += length;
+        _data[_length] = '\0';
+
+        return *this;
+    }
+
+    StringBuilder& append(const char* value) { return append(value, strlen(value)); }
+    StringBuilder& append(std::string_view value) { return append(value.data(), value.length()); }
+    StringBuilder& append(const std::string& value) { return append(value.data(), value.length()); }
+    StringBuilder& append(char value) { return append(&value, 1); }
+
+    template <typename... Args>
+    StringBuilder& appendf(const char* fmt, Args&&... args) {
+        const auto available = _capacity - _length;
+
+        auto length = strformat_to(_data + _length, available + 1, fmt, args...);
+        ESP_ASSERT_CHECK(length >= 0);
+
+        if (size_t(length) > available) {
+            reserve(_length + length);
+
+            strformat_to(_data + _length, length + 1, fmt, args...);
+        }
+
+        _length += length;
+
+        return *this;
+    }
+
+    void clear() {
+        _length = 0;
+        _data[0] = '\0';
+    }
+
+    const char* c_str() const { return _data; }
+    size_t length() const { return _length; }
+    bool empty() const { return !_length; }
+    bool is_inline() const { return _data == _buffer; }
+    std::string_view view() const { return {_data, _length}; }
+    std::string str() const { return {_data, _length}; }
+
+    operator std::string_view() const { return view(); }
+
+private:
+    void reserve(size_t capacity) {
+        if (capacity <= _capacity) {
+            return;
+        }
+
+        capacity = std::max(capacity, _capacity * 2);
+
+        auto data = new char[capacity + 1];
+        memcpy(data, _data, _length + 1);
+
+        if (_data != _buffer) {
+            delete[] _data;
+        }
+
+        _data = data;
+        _capacity = capacity;
+    }
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef LV_SIMULATOR
+#include <mutex>
+#else
+#include "freertos/FreeRTOS.h"
+#include "freertos/portmacro.h"
+#include "sdkconfig.h"
+#endif
+
+#ifndef CONFIG_ESP_SUPPORT_QUEUE_MAX_TIMERS
+#define CONFIG_ESP_SUPPORT_QUEUE_MAX_TIMERS 16
+#endif
+
+class TimerHandle {
+    uint16_t _index{};
+    uint16_t _generation{};
+
+    TimerHandle(uint16_t index, uint16_t generation) : _index(index), _generation(generation) {}
+
+public:
+    TimerHandle() = default;
+
+    bool is_valid() const { return _generation != 0; }
+
+    friend class TimerScheduler;
+};
+
+// Fixed capacity min-heap of timers. The scheduler doesn't run anything itself; it hands
+// out opaque payloads of due timers to its owner (see Queue). All operations run in short
+// critical sections that only move a few integers around; nothing is allocated or copied
+// while the lock is held.
+//
+// A timer goes through these states:
+//
+//   schedule() -> Scheduled -> pop_due() -> Fired -> acquire() -> Running -> complete()
+//
+// complete() puts periodic timers back in the heap. cancel() can be called in any state.
+// If the timer is Fired or Running, it's only flagged and the payload is handed back by
+// acquire() or complete().
+class TimerScheduler {
+    static constexpr size_t CAPACITY = CONFIG_ESP_SUPPORT_QUEUE_MAX_TIMERS;
+    static constexpr uint16_t NONE = UINT16_MAX;
+
+    static_assert(CAPACITY < NONE, "Too many timers");
+
+    enum class State : uint8_t { Free, Scheduled, Fired, Running, Cancelled };
+
+    struct Timer {
+        int64_t deadline;
+        int64_t period_us;
+        void* payload;
+        uint16_t generation;
+        // Position in the heap while scheduled; next free timer while free.
+        uint16_t link;
+        State state;
+    };
+
+    Timer _timers[CAPACITY]{};
+    uint16_t _heap[CAPACITY]{};
+    uint16_t _heap_size{};
+    uint16_t _free_head{};
+#ifdef LV_SIMULATOR
+    std::mutex _lock;
+#else
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+public:
+    TimerScheduler();
+
+    // Returns an invalid handle when all timers are in use. A period of 0 schedules
+    // a one-shot timer.
+    TimerHandle schedule(void* payload, int64_t deadline, int64_t period_us = 0);
+
+    // Returns whether the timer was still pending. If the payload can be released
+    // immediately, it's returned through payload; otherwise payload is set to nullptr
+    // and it'll be returned from acquire() or complete().
+    bool cancel(TimerHandle handle, void*& payload);
+
+    // Takes the earliest timer that is due at now out of the heap.
+    bool pop_due(int64_t now, TimerHandle& handle);
+
+    // Marks a fired timer as running and returns its payload. If the timer was cancelled
+    // after it fired, cancelled is set, the timer is released and the payload must be
+    // released by the caller.
+    void* acquire(TimerHandle handle, bool& cancelled);
+
+    // Finishes running a timer. Periodic timers are scheduled again and false is returned.
+    // Otherwise the timer is released and true is returned; the caller must release the
+    // payload.
+    bool complete(TimerHandle handle, int64_t now);
+
+    // Earliest deadline of all scheduled timers, or INT64_MAX if there are none.
+    int64_t next_deadline();
+
+private:
+#ifdef LV_SIMULATOR
+    void lock() { _lock.lock(); }
+    void unlock() { _lock.unlock(); }
+#else
+    void lock() { portENTER_CRITICAL(&_lock); }
+    void unlock() { portEXIT_CRITICAL(&_lock); }
+#endif
+    Timer* get(TimerHandle handle);
+    void release(uint16_t index);
+    bool less(uint16_t a, uint16_t b) const { return _timers[_heap[a]].deadline < _timers[_heap[b]].deadline; }
+    void swap(uint16_t a, uint16_t b);
+    void push(uint16_t index);
+    void remove(uint16_t position);
+    void sift_up(uint16_t position);
+    void sift_down(uint16_t position);
+};
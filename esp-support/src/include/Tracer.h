@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+#include "defer.h"
+#include "esp_err.h"
+
+#ifndef LV_SIMULATOR
+#include "sdkconfig.h"
+#endif
+
+#ifndef CONFIG_ESP_SUPPORT_TRACE_BUFFER_SIZE
+#define CONFIG_ESP_SUPPORT_TRACE_BUFFER_SIZE 512
+#endif
+
+enum class TraceEventType : uint8_t { Begin, End, Instant };
+
+struct TraceEvent {
+    // Static string; only the pointer is recorded.
+    const char* name;
+    // Task that recorded the event, or nullptr for an ISR.
+    void* task;
+    // Truncated to 32 bits, so traces wrap after 71 minutes.
+    uint32_t time_us;
+    TraceEventType type;
+};
+
+// Records timestamped events into a lock-free ring per core, so recording never blocks
+// and is safe from ISRs. When a ring is full, new events are dropped until the trace is
+// dumped, which keeps the start of a trace intact, e.g. the startup of the application.
+//
+// Dumps are in the Trace Event format of Chrome (JSON Array Format), which can be loaded
+// into chrome://tracing or https://ui.perfetto.dev. Dumping drains the rings.
+//
+// Use the TRACE_* macros instead of calling the tracer directly. They compile to nothing
+// unless ESP_SUPPORT_TRACE is enabled.
+class Tracer {
+public:
+    // Receives the JSON in chunks that may split events. Concatenating the chunks in order
+    // gives the complete trace.
+    using Sink = std::function<esp_err_t(std::string_view chunk)>;
+
+    static void record(TraceEventType type, const char* name);
+
+    // Only one dump may run at a time; returns ESP_ERR_INVALID_STATE otherwise. Returns
+    // ESP_ERR_NOT_SUPPORTED when tracing is disabled.
+    static esp_err_t dump(const Sink& sink);
+    // Erases the data partition with the label and writes the trace into it. Read it back
+    // with parttool.py and strip the trailing 0xff bytes of the erased flash.
+    static esp_err_t dump_to_partition(const char* label);
+
+    // Number of events dropped because a ring was full.
+    static uint32_t get_dropped();
+};
+
+class TraceScope {
+    const char* _name;
+
+public:
+    explicit TraceScope(const char* name) : _name(name) { Tracer::record(TraceEventType::Begin, name); }
+    ~TraceScope() { Tracer::record(TraceEventType::End, _name); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+#if CONFIG_ESP_SUPPORT_TRACE
+
+// Names must be string literals; the concatenation rejects anything else.
+#define TRACE_BEGIN(name) Tracer::record(TraceEventType::Begin, "" name "")
+#define TRACE_END(name) Tracer::record(TraceEventType::End, "" name "")
+#define TRACE_INSTANT(name) Tracer::record(TraceEventType::Instant, "" name "")
+// Traces the rest of the enclosing block.
+#define TRACE_SCOPE(name) TraceScope CONCAT(_trace_scope_, __LINE__)("" name "")
+
+#else
+
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+#define TRACE_SCOPE(name) ((void)0)
+
+#endif
@@ -19,13 +19,27 @@ auto to_printf_arg(T&& arg) {
 
 }  // namespace detail
 
+// Formats into a caller provided buffer. Like snprintf, the result is truncated to
+// fit and the length of the untruncated result is returned.
+template <typename... Args>
+int strformat_to(char* buffer, size_t size, const char* fmt, Args&&... args) {
+    return snprintf(buffer, size, fmt, detail::to_printf_arg(args)...);
+}
+
 template <typename... Args>
 std::string strformat(const char* fmt, Args&&... args) {
-    auto length = snprintf(nullptr, 0, fmt, detail::to_printf_arg(std::forward<Args>(args))...);
+    // Most results fit on the stack, so only format a second time when they don't.
+    char buffer[128];
+
+    auto length = strformat_to(buffer, sizeof(buffer), fmt, args...);
     ESP_ASSERT_CHECK(length >= 0);
 
+    if (size_t(length) < sizeof(buffer)) {
+        return std::string(buffer, length);
+    }
+
     std::string result(length, '\0');
-    snprintf(result.data(), length + 1, fmt, detail::to_printf_arg(std::forward<Args>(args))...);
+    strformat_to(result.data(), length + 1, fmt, args...);
 
     return result;
 }
@@ -10,6 +10,8 @@ Buffer::Buffer(const uint8_t* data, int length) {
     memcpy(_data, data, length);
 }
 
+Buffer::Buffer(ByteView data) : Buffer(data.data(), int(data.size())) {}
+
 Buffer::Buffer(const Buffer& other) : Buffer(other._data, other._length) {}
 
 Buffer::Buffer(Buffer&& other) noexcept {
@@ -2,13 +2,22 @@
 
 #include "StatusControl.h"
 
-#include "esp_timer.h"
+#include "Clock.h"
 
 LOG_TAG(StatusControl);
 
-static uint32_t millis() { return esp_timer_get_time() / 1000; }
+// Unless the button is interrupt driven, it's polled at this rate, so this bounds
+// the latency of a click. The blink and fade animations run at the same rate.
+static constexpr uint32_t UPDATE_INTERVAL = 10;
 
-void StatusControl::setBounce(Bounce bounce) { _bounce = bounce; }
+static uint32_t millis() { return uint32_t(Clock::now_ms()); }
+
+void StatusControl::setBounce(Bounce bounce) {
+    _bounce = bounce;
+    _debouncer = &_bounce;
+}
+
+void StatusControl::setDebouncer(Debouncer* debouncer) { _debouncer = debouncer; }
 
 void StatusControl::setConnected(connection_status_t connected) {
     if (_connected != connected) {
@@ -31,19 +40,19 @@ void StatusControl::reportRemaining(int remaining) {
 }
 
 void StatusControl::update() {
-    _bounce.update();
+    _debouncer->update();
 
     auto currentMillis = millis();
 
-    if (_bounce.read()) {
+    if (_debouncer->read()) {
         if (!_isHigh) {
             _lastStatusChange = currentMillis;
             _isHigh = true;
             _click.call();
             setLevel(1);
         }
-        if (_bounce.currentDuration() > _initialDelay) {
-            auto duration = _bounce.currentDuration() - _initialDelay;
+        if (_debouncer->currentDuration() > _initialDelay) {
+            auto duration = _debouncer->currentDuration() - _initialDelay;
             auto steps = duration / _stepTime;
             int remaining = _steps - (int)steps;
 
@@ -77,7 +86,7 @@ void StatusControl::update() {
         // the reset will be raised to toggle the led.
 
         auto total = _initialDelay + _steps * _stepTime;
-        auto target = currentMillis - _bounce.currentDuration() + total;
+        auto target = currentMillis - _debouncer->currentDuration() + total;
         auto remaining = target - _lastStatusChange;
         auto nextToggle = (remaining * 10) / 100;
         if (nextToggle < 25) {
@@ -107,6 +116,16 @@ void StatusControl::update() {
     }
 }
 
+uint32_t StatusControl::getUpdateDelay() {
+    // An interrupt driven button wakes the queue when it changes, so we only need to
+    // run while something is animating.
+    if (!_debouncer->needsPolling() && !_isHigh && _connected != CONNECTION_STATUS_CONNECTING && !_levelSet) {
+        return UINT32_MAX;
+    }
+
+    return UPDATE_INTERVAL;
+}
+
 void StatusControl::setLevel(float level) {
     if (level != _lastLevel || !_levelSet) {
         _lastLevel = level;
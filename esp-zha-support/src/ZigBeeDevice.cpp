@@ -2,10 +2,18 @@
 
 #include "ZigBeeDevice.h"
 
+#include "HeapAccount.h"
+#include "Metrics.h"
 #include "ZigBeeEndpoint.h"
 
 LOG_TAG(ZigBeeDevice);
 
+static MetricCounter commands_metric("zigbee.commands");
+static MetricCounter actions_metric("zigbee.actions");
+
+// Devices bound to the endpoints, recalled from the binding table.
+static HeapAccount heap_account("zigbee");
+
 static constexpr uint32_t ZB_MAIN_TASK_STACK_SIZE = 6192;
 
 static ZigBeeDevice *APP_INSTANCE = nullptr;
@@ -350,6 +358,8 @@ void ZigBeeDevice::zbSignalHandler(esp_zb_app_signal_t *signal_struct) {
 }
 
 uint8_t ZigBeeDevice::zbDeviceHandler(uint8_t param) {
+    commands_metric.increment();
+
     zb_zcl_parsed_hdr_t cmd_info;
     ZB_MEMCPY(&cmd_info, ZB_BUF_GET_PARAM(param, zb_zcl_parsed_hdr_t), sizeof(zb_zcl_parsed_hdr_t));
 
@@ -461,7 +471,7 @@ void ZigBeeDevice::bindingTableCb(const esp_zb_zdo_binding_table_info_t *table_i
             ESP_LOGD(TAG, "Binding table record: src_endp %d, dst_endp %d, cluster_id 0x%04x, dst_addr_mode %d",
                      record->src_endp, record->dst_endp, record->cluster_id, record->dst_addr_mode);
 
-            zb_device_params_t *device = (zb_device_params_t *)calloc(1, sizeof(zb_device_params_t));
+            zb_device_params_t *device = heap_account.create<zb_device_params_t>();
             device->endpoint = record->dst_endp;
             if (record->dst_addr_mode == ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT ||
                 record->dst_addr_mode == ESP_ZB_APS_ADDR_MODE_16_GROUP_ENDP_NOT_PRESENT) {
@@ -522,6 +532,8 @@ void ZigBeeDevice::searchBindings() {
 }
 
 esp_err_t ZigBeeDevice::zbActionHandler(esp_zb_core_action_callback_id_t callback_id, const void *message) {
+    actions_metric.increment();
+
     switch (callback_id) {
         case ESP_ZB_CORE_SET_ATTR_VALUE_CB_ID:
             return zbAttributeSetHandler((esp_zb_zcl_set_attr_value_message_t *)message);
@@ -500,72 +500,75 @@ void ZigBeeStream::writeDouble(double value) {
     _position += sizeof(double);
 }
 
-Buffer ZigBeeStream::readOctstr() { return readOctstrData(readUInt8()); }
+Buffer ZigBeeStream::readOctstr() { return Buffer(readOctstrView()); }
 
-Buffer ZigBeeStream::readOctstr16Le() { return readOctstrData(readUInt16Le()); }
+Buffer ZigBeeStream::readOctstr16Le() { return Buffer(readOctstr16LeView()); }
 
-Buffer ZigBeeStream::readOctstrData(int length) {
-    auto result = Buffer(_data + _position, length);
-    _position += length;
-    return result;
-}
+void ZigBeeStream::writeOctstr(const Buffer& value) { writeOctstr(value.view()); }
 
-void ZigBeeStream::writeOctstr(const Buffer& value) {
-    int length = value.length();
-    if (length > 254) {
-        ESP_LOGE(TAG, "Writing octstr of more than 254 bytes");
-    }
-    writeUInt8(length);
-    writeOctstrData(value);
-}
+void ZigBeeStream::writeOctstr16Le(const Buffer& value) { writeOctstr16Le(value.view()); }
 
-void ZigBeeStream::writeOctstr16Le(const Buffer& value) {
-    int length = value.length();
-    writeUInt16Le(length);
-    writeOctstrData(value);
-}
+std::string ZigBeeStream::readString() { return std::string(readStringView()); }
 
-void ZigBeeStream::writeOctstrData(const Buffer& value) {
-    value.getBytes(_data + _position);
-    _position += value.length();
-}
+std::string ZigBeeStream::readString16Le() { return std::string(readString16LeView()); }
+
+void ZigBeeStream::writeString(const std::string& value) { writeString(std::string_view(value)); }
+
+void ZigBeeStream::writeString16Le(const std::string& value) { writeString16Le(std::string_view(value)); }
 
-std::string ZigBeeStream::readString() { return readStringData(readUInt8()); }
+ByteView ZigBeeStream::readOctstrView() { return readData(readUInt8()); }
 
-std::string ZigBeeStream::readString16Le() { return readStringData(readUInt16Le()); }
+ByteView ZigBeeStream::readOctstr16LeView() { return readData(readUInt16Le()); }
 
-std::string ZigBeeStream::readStringData(int length) {
-    auto result = std::string();
+std::string_view ZigBeeStream::readStringView() { return as_string_view(readData(readUInt8())); }
 
-    // See
-    // https://github.com/arduino/ArduinoCore-sam/blob/790ff2c852bf159787a9966bddee4d9f55352d15/cores/arduino/WString.cpp#L159.
-    // Reserve reserves the maximum string length, not the number of bytes.
-    // It'll actually allocate one extra byte.
-    result.reserve(length);
+std::string_view ZigBeeStream::readString16LeView() { return as_string_view(readData(readUInt16Le())); }
 
-    for (int i = 0; i < length; i++) {
-        result += (char)readUInt8();
+void ZigBeeStream::writeOctstr(ByteView value) {
+    int length = value.size();
+    if (length > 254) {
+        ESP_LOGE(TAG, "Writing octstr of more than 254 bytes");
     }
-    return result;
+    writeUInt8(length);
+    writeData(value);
+}
+
+void ZigBeeStream::writeOctstr16Le(ByteView value) {
+    int length = value.size();
+    writeUInt16Le(length);
+    writeData(value);
 }
 
-void ZigBeeStream::writeString(const std::string& value) {
+void ZigBeeStream::writeString(std::string_view value) {
     int length = value.length();
     if (length > 254) {
         ESP_LOGE(TAG, "Writing string of more than 254 bytes");
     }
     writeUInt8(length);
-    writeStringData(value);
+    writeData(as_bytes(value));
 }
 
-void ZigBeeStream::writeString16Le(const std::string& value) {
+void ZigBeeStream::writeString16Le(std::string_view value) {
     int length = value.length();
     writeUInt16Le(length);
-    writeStringData(value);
+    writeData(as_bytes(value));
 }
 
-void ZigBeeStream::writeStringData(const std::string& value) {
-    int length = value.length();
-    memcpy(_data + _position, value.c_str(), length);
+ByteView ZigBeeStream::readData(int length) {
+    if (size_t(length) > remaining().size()) {
+        ESP_LOGE(TAG, "Reading %d bytes past the end of the stream", length - int(remaining().size()));
+        _position = _length;
+        return {};
+    }
+
+    auto result = ByteView(_data + _position, length);
     _position += length;
+    return result;
+}
+
+void ZigBeeStream::writeData(ByteView value) {
+    if (!value.empty()) {
+        memcpy(_data + _position, value.data(), value.size());
+    }
+    _position += value.size();
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Span.h"
+
 class Buffer
 {
 	uint8_t* _data;
@@ -8,6 +10,7 @@ class Buffer
 public:
 	Buffer();
 	Buffer(const uint8_t* data, int length);
+	explicit Buffer(ByteView data);
 	Buffer(const Buffer& other);
 	Buffer(Buffer&& other) noexcept;
 	~Buffer();
@@ -18,5 +21,9 @@ public:
 		return _length;
 	}
 
+	ByteView view() const {
+		return {_data, size_t(_length)};
+	}
+
 	void getBytes(uint8_t* data) const;
 };
@@ -13,6 +13,7 @@ enum connection_status_t {
 
 class StatusControl {
     Bounce _bounce;
+    Debouncer* _debouncer{&_bounce};
     bool _isHigh = false;
     Callback<void> _click;
     Callback<void> _reset;
@@ -35,14 +36,22 @@ public:
         : _initialDelay(initialDelay), _steps(steps), _stepTime(stepTime), _fadePeriod(fadePeriod) {}
 
     void setBounce(Bounce bounce);
+    // Uses a debouncer owned by the caller instead, e.g. a pin of an InterruptDebouncer.
+    void setDebouncer(Debouncer* debouncer);
     void setConnected(connection_status_t connected);
     void reportRemaining(int remaining);
     void update();
-    void onClick(std::function<void(void)> func) { _click.add(func); }
-    void onReset(std::function<void(void)> func) { _reset.add(func); }
-    void onResetCountdown(std::function<void(int)> func) { _resetCountdown.add(func); }
-    void onLedBrightnessChanged(std::function<void(float)> func) { _ledBrightnessChanged.add(func); }
-    void onLedBrightnessReset(std::function<void(void)> func) { _ledBrightnessReset.add(func); }
+    // Milliseconds until update() needs to be called again.
+    uint32_t getUpdateDelay();
+    CallbackToken onClick(Callback<void>::Function func) { return _click.add(std::move(func)); }
+    CallbackToken onReset(Callback<void>::Function func) { return _reset.add(std::move(func)); }
+    CallbackToken onResetCountdown(Callback<int>::Function func) { return _resetCountdown.add(std::move(func)); }
+    CallbackToken onLedBrightnessChanged(Callback<float>::Function func) {
+        return _ledBrightnessChanged.add(std::move(func));
+    }
+    CallbackToken onLedBrightnessReset(Callback<void>::Function func) {
+        return _ledBrightnessReset.add(std::move(func));
+    }
 
 private:
     void setLevel(float level);
@@ -46,7 +46,7 @@ public:
     uint8_t get();
     uint8_t get(uint8_t default_value);
     void set(uint8_t value) { doSet(&value); }
-    void onChanged(std::function<void(uint8_t)> func) { _changed.add(func); }
+    CallbackToken onChanged(Callback<uint8_t>::Function func) { return _changed.add(std::move(func)); }
 
     esp_err_t addToCluster(esp_zb_attribute_list_t* attr_list,
                            std::function<esp_err_t(esp_zb_attribute_list_t*, uint16_t, void*)> func, uint8_t value) {
@@ -76,7 +76,7 @@ public:
     uint16_t get();
     uint16_t get(uint16_t default_value);
     void set(uint16_t value) { doSet(&value); }
-    void onChanged(std::function<void(uint16_t)> func) { _changed.add(func); }
+    CallbackToken onChanged(Callback<uint16_t>::Function func) { return _changed.add(std::move(func)); }
 
     esp_err_t addToCluster(esp_zb_attribute_list_t* attr_list,
                            std::function<esp_err_t(esp_zb_attribute_list_t*, uint16_t, void*)> func, uint16_t value) {
@@ -95,7 +95,7 @@ public:
     esp_err_t begin(esp_zb_cfg_t *role_cfg, bool erase_nvs = false);
 
     bool started() { return _started; }
-    void onStarted(std::function<void(void)> func) { _started_cb.add(func); }
+    CallbackToken onStarted(Callback<void>::Function func) { return _started_cb.add(std::move(func)); }
     esp_zb_nwk_device_type_t getRole() { return _role; }
 
     void addEndpoint(ZigBeeEndpoint *ep);
@@ -50,7 +50,7 @@ public:
     uint8_t getEndpoint() { return _endpoint_config.endpoint; }
     void printBoundDevices();
     void setBatteryPercentage(uint8_t percentage);
-    void onIdentify(std::function<void(uint16_t)> func) { _identify.add(func); }
+    CallbackToken onIdentify(Callback<uint16_t>::Function func) { return _identify.add(std::move(func)); }
     ZigBeeCommandBuilder createCoordinatorCommand();
     void addCommandFilter(ZigBeeCommandFilter *command_filter) { _command_filters.push_back(command_filter); }
 
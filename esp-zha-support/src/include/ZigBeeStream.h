@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 
 #include "Buffer.h"
 #include "esp_zigbee_core.h"
@@ -25,6 +26,9 @@ public:
 
     bool atEnd() { return _position >= _length; }
 
+    // Remaining data after the current position.
+    ByteView remaining() { return atEnd() ? ByteView() : ByteView(_data + _position, size_t(_length - _position)); }
+
     int8_t readInt8() { return (int8_t)_data[_position++]; }
 
     uint8_t readUInt8() { return _data[_position++]; }
@@ -107,9 +111,18 @@ public:
     void writeString(const std::string& value);
     void writeString16Le(const std::string& value);
 
+    // These return views into the data of the stream instead of copies. They're only
+    // valid as long as the data is.
+    ByteView readOctstrView();
+    ByteView readOctstr16LeView();
+    std::string_view readStringView();
+    std::string_view readString16LeView();
+    void writeOctstr(ByteView value);
+    void writeOctstr16Le(ByteView value);
+    void writeString(std::string_view value);
+    void writeString16Le(std::string_view value);
+
 private:
-    Buffer readOctstrData(int length);
-    void writeOctstrData(const Buffer& value);
-    std::string readStringData(int length);
-    void writeStringData(const std::string& value);
+    ByteView readData(int length);
+    void writeData(ByteView value);
 };